@@ -0,0 +1,122 @@
+/**
+ * amount.h - hns amount helpers
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ *
+ * These helpers do not depend on the SDK, so they
+ * can be built and tested on the host.
+ */
+#ifndef _HNS_AMOUNT_H
+#define _HNS_AMOUNT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Amount in dollarydoos.
+ */
+typedef uint64_t hns_amount_t;
+
+/**
+ * Formats an amount in HNS, e.g. 1.5 for 1500000 dollarydoos.
+ *
+ * The amount is split into 16-bit chunks and long divided by
+ * 10^4, yielding four decimal digits per pass. Every partial
+ * remainder fits in 32 bits, so no 64-bit division is needed.
+ *
+ * In:
+ * @param amt is the amount.
+ *
+ * Out:
+ * @param dec is the formatted amount, at least 22 bytes.
+ * @return the length of the formatted amount.
+ */
+static inline uint8_t
+amount_to_dec(char *dec, hns_amount_t amt) {
+  uint16_t chunks[4];
+  char digits[20];
+  uint8_t i, j;
+  uint8_t len = 0;
+
+  for (i = 0; i < 4; i++)
+    chunks[i] = amt >> (48 - 16 * i);
+
+  for (i = sizeof(digits); i > 0; i -= 4) {
+    uint32_t rem = 0;
+
+    for (j = 0; j < 4; j++) {
+      uint32_t cur = (rem << 16) | chunks[j];
+      chunks[j] = cur / 10000;
+      rem = cur % 10000;
+    }
+
+    for (j = 1; j <= 4; j++) {
+      digits[i - j] = '0' + rem % 10;
+      rem /= 10;
+    }
+  }
+
+  /* Keep at least one integer digit. */
+  for (i = 0; i < 13 && digits[i] == '0'; i++);
+
+  while (i < 14)
+    dec[len++] = digits[i++];
+
+  /* Trim the trailing zeros of the 6 decimals. */
+  for (j = sizeof(digits); j > 14 && digits[j - 1] == '0'; j--);
+
+  if (j > 14) {
+    dec[len++] = '.';
+
+    while (i < j)
+      dec[len++] = digits[i++];
+  }
+
+  dec[len] = '\0';
+
+  return len;
+}
+
+/**
+ * Adds two amounts.
+ *
+ * In:
+ * @param a is the first amount.
+ * @param b is the second amount.
+ *
+ * Out:
+ * @param target is the sum.
+ * @return a boolean indicating if the sum did not overflow.
+ */
+static inline bool
+add_amount(hns_amount_t *target, hns_amount_t a, hns_amount_t b) {
+  if (b > UINT64_MAX - a)
+    return false;
+
+  *target = a + b;
+
+  return true;
+}
+
+/**
+ * Subtracts an amount from another.
+ *
+ * In:
+ * @param a is the amount to subtract from.
+ * @param b is the amount to subtract.
+ *
+ * Out:
+ * @param target is the difference.
+ * @return a boolean indicating if the difference did not underflow.
+ */
+static inline bool
+sub_amount(hns_amount_t *target, hns_amount_t a, hns_amount_t b) {
+  if (b > a)
+    return false;
+
+  *target = a - b;
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * apdu-capabilities.c - protocol features and limits for hns
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#include "apdu.h"
+#include "ledger.h"
+#include "utils.h"
+
+/**
+ * Version of the capabilities format. New fields are
+ * only ever appended, and bump the format version.
+ * Each group of fields below is marked with the version
+ * that added it.
+ */
+#define FORMAT_VERSION 0x02
+
+/**
+ * Largest command data payload accepted per message.
+ */
+#define MAX_CDATA_LEN 0xff
+
+/**
+ * Maximum number of inputs and outputs per transaction.
+ */
+#define MAX_INPUTS 0xff
+#define MAX_OUTPUTS 0xff
+
+/**
+ * Supported sighash types, where bit n is set if base type n is
+ * supported (ALL, NONE, SINGLE, SINGLEREVERSE), and supported
+ * sighash modifiers (NOINPUT, ANYONECANPAY).
+ */
+#define SIGHASH_TYPES 0x1e
+#define SIGHASH_MODIFIERS 0xc0
+
+/**
+ * Supported covenant types, where bit n is set if type n is supported.
+ */
+#define COVENANT_TYPES ((1 << (HNS_REVOKE + 1)) - 1)
+
+/**
+ * Optional protocol features supported by this app version.
+ */
+#define FEATURES (HNS_FEATURE_CHANGE_OUTPUTS  \
+                | HNS_FEATURE_ANYONECANPAY    \
+                | HNS_FEATURE_COMPACT_NAMES   \
+                | HNS_FEATURE_COMPACT_PREVS   \
+                | HNS_FEATURE_SCRIPT_POOL     \
+                | HNS_FEATURE_APPEND_PUBKEY   \
+                | HNS_FEATURE_EXPORT_IMPORT   \
+                | HNS_FEATURE_AUCTION         \
+                | HNS_FEATURE_PARSE_TXID      \
+                | HNS_FEATURE_RESOURCES       \
+                | HNS_FEATURE_ACCOUNT_XPUBS   \
+                | HNS_FEATURE_SIGN_MESSAGE)
+
+uint8_t
+hns_apdu_get_capabilities(
+  uint8_t p1,
+  uint8_t p2,
+  uint8_t len,
+  volatile uint8_t *in,
+  volatile uint8_t *out,
+  volatile uint8_t *flags
+) {
+  if (!ledger_unlocked())
+    THROW(HNS_SECURITY_CONDITION_NOT_SATISFIED);
+
+  if(p1 != 0)
+    THROW(HNS_INCORRECT_P1);
+
+  if(p2 != 0)
+    THROW(HNS_INCORRECT_P2);
+
+  if(len != 0)
+    THROW(HNS_INCORRECT_LC);
+
+  /* Format version 0x01. */
+  len = write_u8(&out, FORMAT_VERSION);
+  len += write_u32(&out, FEATURES, HNS_LE);
+  len += write_u8(&out, MAX_CDATA_LEN);
+  len += write_u8(&out, LEDGER_APDU_CACHE_SIZE);
+  len += write_u8(&out, MAX_INPUTS);
+  len += write_u8(&out, MAX_OUTPUTS);
+  len += write_u8(&out, HNS_MAX_CHANGE_OUTPUTS);
+  len += write_u8(&out, SIGHASH_TYPES);
+  len += write_u8(&out, SIGHASH_MODIFIERS);
+  len += write_u16(&out, COVENANT_TYPES, HNS_LE);
+  len += write_u8(&out, HNS_AUCTION_PAGE_SIZE);
+  len += write_u8(&out, HNS_MAX_SCRIPTS);
+  len += write_u8(&out, HNS_SCRIPT_POOL_SIZE);
+  len += write_u8(&out, HNS_TXID_TABLE_SIZE);
+
+  /* Format version 0x02. */
+  len += write_u8(&out, HNS_XPUB_PAGE_SIZE);
+
+  return len;
+}
@@ -0,0 +1,133 @@
+/**
+ * apdu-message.c - message signing for hns
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#include <string.h>
+#include "apdu.h"
+#include "ledger.h"
+#include "utils.h"
+
+/**
+ * This constant is used to inspect P1's least significant bit.
+ * This bit indicates the first message of a signing request.
+ */
+#define P1_INIT_MASK 0x01
+
+/**
+ * Domain prefix of signed messages, as used by hsd.
+ */
+#define PREFIX "handshake signed message:\n"
+
+/**
+ * Messages are streamed through the hash context, so memory
+ * use does not depend on the message size. Both share memory
+ * with the transaction signing state.
+ */
+static ledger_blake2b_ctx * const hash = &g_hns_sign.msg_hash;
+static hns_msg_t * const msg = &g_hns_sign.msg;
+
+/**
+ * Keeps the first bytes of the message for the on-screen preview.
+ *
+ * In:
+ * @param buf is the message chunk.
+ * @param len is the length of the message chunk.
+ */
+static inline void
+capture_preview(volatile uint8_t *buf, uint16_t len) {
+  uint16_t i;
+
+  for (i = 0; i < len && msg->preview_len < HNS_MSG_PREVIEW_LEN; i++) {
+    uint8_t ch = buf[i];
+
+    if (ch < 0x20 || ch > 0x7e)
+      ch = '?';
+
+    msg->preview[msg->preview_len++] = ch;
+  }
+
+  msg->preview[msg->preview_len] = '\0';
+}
+
+uint16_t
+hns_apdu_sign_message(
+  uint8_t p1,
+  uint8_t p2,
+  uint16_t len,
+  volatile uint8_t *buf,
+  volatile uint8_t *out,
+  volatile uint8_t *flags
+) {
+  if (!ledger_unlocked())
+    THROW(HNS_SECURITY_CONDITION_NOT_SATISFIED);
+
+  if (p1 & ~P1_INIT_MASK)
+    THROW(HNS_INCORRECT_P1);
+
+  if (p2 != 0)
+    THROW(HNS_INCORRECT_P2);
+
+  ledger_ui_ctx_t *ui = &g_ledger.ui;
+
+  if (p1 & P1_INIT_MASK) {
+    uint32_t path[HNS_MAX_DEPTH];
+    uint8_t path_info = 0;
+
+    ui = ledger_ui_init_session();
+    memset(msg, 0, sizeof(hns_msg_t));
+    g_hns_sign.owner = HNS_SIGN_OWNER_MSG;
+    ledger_apdu_cache_clear(LEDGER_APDU_CACHE_TX);
+
+    if (!read_bip44_path(&buf, &len, &msg->depth, path, &path_info))
+      THROW(HNS_CANNOT_READ_BIP44_PATH);
+
+    if (path_info & HNS_BIP44_NON_ADDR)
+      THROW(HNS_INCORRECT_SIGNATURE_PATH);
+
+    memmove(msg->path, path, sizeof(msg->path));
+
+    if (!read_u32(&buf, &len, &msg->len, HNS_LE))
+      THROW(HNS_CANNOT_READ_MESSAGE_LEN);
+
+    ledger_blake2b_init(hash, 32);
+    ledger_blake2b_update(hash, PREFIX, sizeof(PREFIX) - 1);
+    msg->left = msg->len;
+    msg->streaming = true;
+  }
+
+  if (g_hns_sign.owner != HNS_SIGN_OWNER_MSG || !msg->streaming)
+    THROW(HNS_INCORRECT_PARSER_STATE);
+
+  if (len > msg->left)
+    THROW(HNS_INCORRECT_MESSAGE_LEN);
+
+  capture_preview(buf, len);
+  ledger_blake2b_update(hash, buf, len);
+  msg->left -= len;
+
+  if (msg->left > 0)
+    return 0;
+
+  msg->streaming = false;
+  ledger_blake2b_final(hash, msg->digest);
+
+  if (!ledger_ecdsa_sign(msg->path, msg->depth, msg->digest, 32, out, 64, NULL))
+    THROW(HNS_FAILED_TO_SIGN_MESSAGE);
+
+  if (!ledger_apdu_cache_write(LEDGER_APDU_CACHE_TX, NULL, 64))
+    THROW(HNS_CACHE_WRITE_ERROR);
+
+  if (msg->len == 0)
+    strcpy(msg->preview, "(empty)");
+  else if (msg->len > msg->preview_len)
+    strcat(msg->preview, "...");
+
+  ui->ctx = (void *)msg;
+  ui->flags = flags;
+
+  if (!ledger_ui_update(LEDGER_UI_MESSAGE, "Message", msg->preview, flags))
+    THROW(HNS_CANNOT_UPDATE_UI);
+
+  return 0;
+}
@@ -7,7 +7,6 @@
 #include "apdu.h"
 #include "ledger.h"
 #include "libbase58.h"
-#include "segwit-addr.h"
 #include "utils.h"
 
 /**
@@ -47,20 +46,20 @@
  * Encodes a pubkey hash in bech32 format.
  *
  * In:
- * @param hrp is the human readable part of bech32 encoding.
+ * @param network is the network index of the address.
  * @param pubkey is the pubkey to encode.
  *
  * Out:
  * @param addr is the encoded address.
  */
 static inline void
-encode_addr(char *hrp, uint8_t *pubkey, char *addr) {
+encode_addr(uint8_t network, uint8_t *pubkey, char *addr) {
   uint8_t hash[20];
 
   if (ledger_blake2b(pubkey, 33, hash, 20))
     THROW(HNS_CANNOT_INIT_BLAKE2B_CTX);
 
-  if (!segwit_addr_encode(addr, hrp, 0, hash, 20))
+  if (!encode_segwit_addr(addr, network, 0, hash, 20))
     THROW(HNS_CANNOT_ENCODE_ADDRESS);
 }
 
@@ -118,7 +117,7 @@ encode_xpub(
   ledger_sha256(checksum, 32, checksum);
   write_bytes(&buf, checksum, 4);
 
-  return b58enc(b58, b58_sz, data, sizeof(data));
+  return b58enc_limbs(b58, b58_sz, data, sizeof(data));
 }
 
 uint16_t
@@ -134,6 +133,7 @@ hns_apdu_get_public_key(
     THROW(HNS_SECURITY_CONDITION_NOT_SATISFIED);
 
   ledger_ui_ctx_t *ui = ledger_ui_init_session();
+  bool must_confirm = false;
 
   switch(p1) {
     case DEFAULT | MAINNET:
@@ -146,7 +146,7 @@ hns_apdu_get_public_key(
     case CONFIRM | TESTNET:
     case CONFIRM | REGTEST:
     case CONFIRM | SIMNET:
-      ui->must_confirm = true;
+      must_confirm = true;
       break;
 
     default:
@@ -169,7 +169,7 @@ hns_apdu_get_public_key(
   uint8_t non_address = 0;
   uint8_t non_standard = 0;
 
-  ledger_apdu_cache_clear();
+  ledger_apdu_cache_clear(LEDGER_APDU_CACHE_KEY);
 
   if (!read_bip44_path(&buf, &len, &xpub.depth, xpub.path, &path_info))
     THROW(HNS_CANNOT_READ_BIP44_PATH);
@@ -194,42 +194,21 @@ hns_apdu_get_public_key(
   char addr[75];
 
   if (p2 & ADDR) {
-    char hrp[3];
+    if (xpub.path[1] < HNS_BIP44_MAINNET || xpub.path[1] > HNS_BIP44_SIMNET)
+      THROW(HNS_CANNOT_ENCODE_ADDRESS);
 
-    switch(xpub.path[1]) {
-      case HNS_BIP44_MAINNET:
-        strcpy(hrp, "hs");
-        break;
-
-      case HNS_BIP44_TESTNET:
-        strcpy(hrp, "ts");
-        break;
-
-      case HNS_BIP44_REGTEST:
-        strcpy(hrp, "rs");
-        break;
-
-      case HNS_BIP44_SIMNET:
-        strcpy(hrp, "ss");
-        break;
-
-      default:
-        THROW(HNS_CANNOT_ENCODE_ADDRESS);
-        break;
-    }
-
-    encode_addr(hrp, xpub.key, addr);
+    encode_addr(xpub.path[1] - HNS_BIP44_MAINNET, xpub.key, addr);
 
     len += write_varbytes(&out, (const uint8_t *)addr, 42);
   } else {
     len += write_u8(&out, 0);
   }
 
-  if (ui->must_confirm || non_standard) {
+  if (must_confirm || non_standard) {
     char *hdr = NULL;
     char *msg = NULL;
 
-    if (!ledger_apdu_cache_write(NULL, len))
+    if (!ledger_apdu_cache_write(LEDGER_APDU_CACHE_KEY, NULL, len))
       THROW(HNS_CACHE_WRITE_ERROR);
 
     if (non_standard) {
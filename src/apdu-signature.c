@@ -4,6 +4,7 @@
  * https://github.com/handshake-org/ledger-app-hns
  */
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include "apdu.h"
 #include "ledger.h"
@@ -12,8 +13,13 @@
 /**
  * These constants are used to determine the contents of P1.
  */
-#define P1_INIT_MASK 0x01    /* xx1 */
-#define P1_NETWORK_MASK 0x06 /* 11x */
+#define P1_INIT_MASK 0x01         /* xxxxxxx1 */
+#define P1_NETWORK_MASK 0x06      /* xxxxx11x */
+#define P1_ANYONECANPAY_MASK 0x08 /* xxxx1xxx */
+#define P1_COMPACT_NAME_MASK 0x10 /* xxx1xxxx */
+#define P1_COMPACT_PREV_MASK 0x20 /* xx1xxxxx */
+#define P1_SCRIPT_MASK 0x40       /* x1xxxxxx */
+#define P1_PUBKEY_MASK 0x80       /* 1xxxxxxx */
 #define NO 0x00
 #define YES 0x01
 
@@ -23,6 +29,9 @@
  */
 #define PARSE 0x00
 #define SIGN 0x01
+#define EXPORT 0x02
+#define IMPORT 0x03
+#define AUCTION 0x04
 
 /**
  * These constants are used to determine which transaction
@@ -57,88 +66,380 @@
 #define NO_CHANGE_ADDR 0x00
 #define P2PKH_CHANGE_ADDR 0x01
 #define P2SH_CHANGE_ADDR 0x02
+#define MULTI_P2PKH_CHANGE_ADDR 0x03
 
 /**
- * These constants are used across all covenants.
+ * These constants are used to determine which script
+ * is selected for the input being signed.
  */
-#define NAME_HASH 0x00
-#define HEIGHT 0x01
+#define SCRIPT_P2PKH 0x00
+#define SCRIPT_STORE 0x01
+#define SCRIPT_REF 0x80 /* 1xxxxxxx, low bits are the pool slot */
 
 /**
- * These constants are used to determine the OPEN covenant items.
+ * This constant is the compact prevout tag for a literal txid.
+ * Other tags reference an entry in the txid table.
  */
-#define OPEN_NAME 0x02
+#define PREVOUT_LITERAL 0xff
 
 /**
- * These constants are used to determine the BID covenant items.
+ * These constants are used to determine how a covenant item
+ * is parsed. Items are described in the covenant item table.
  */
-#define BID_NAME 0x02
-#define BID_HASH 0x03
+#define ITEM_END 0x00        /* end of the item list */
+#define ITEM_FIXED 0x01      /* fixed size item */
+#define ITEM_NAME_HASH 0x02  /* name hash, or the name if compact */
+#define ITEM_NAME 0x03       /* name, as an item */
+#define ITEM_NAME_CHECK 0x04 /* name, not an item, checked against hash */
+#define ITEM_ADDR 0x05       /* address hash, preceded by its length */
+#define ITEM_RESOURCE_LEN 0x06
+#define ITEM_RESOURCE 0x07
 
 /**
- * These constants are used to determine the REVEAL covenant items.
+ * Sizes of the serialized session state and its mac.
  */
-#define REVEAL_NONCE 0x02
-#define REVEAL_NAME 0x03
+#define TOKEN_STATE_SIZE 112
+#define TOKEN_MAC_SIZE 32
 
 /**
- * These constants are used to determine the REDEEM covenant items.
+ * Derivation path of the key used to authenticate session tokens.
+ * The purpose level is not a BIP44 purpose, so this key is never
+ * used for addresses or signatures.
  */
-#define REDEEM_NAME 0x02
+static uint32_t token_path[2] = {
+  HNS_HARDENED | 0x686e73, /* hns */
+  HNS_HARDENED | 0x746b6e  /* tkn */
+};
 
 /**
- * These constants are used to determine the REGISTER covenant items.
+ * Describes a covenant item: how it is parsed, its size if
+ * fixed, and its offset in the covenant's items struct.
  */
-#define REGISTER_RESOURCE_LEN 0x02
-#define REGISTER_RESOURCE 0x03
-#define REGISTER_HASH 0x04
-#define REGISTER_NAME 0x05
+typedef struct item_desc_s {
+  uint8_t kind;
+  uint8_t size;
+  uint8_t offset;
+} item_desc_t;
+
+#define NAME_HASH_DESC(t) {ITEM_NAME_HASH, 32, offsetof(t, name_hash)}
+#define HEIGHT_DESC(t) {ITEM_FIXED, 4, offsetof(t, height)}
+#define FIXED_DESC(t, f) {ITEM_FIXED, sizeof(((t *)0)->f), offsetof(t, f)}
+#define NAME_CHECK_DESC(t) {ITEM_NAME_CHECK, 0, offsetof(t, name_hash)}
+#define NAME_DESC {ITEM_NAME, 0, 0}
+#define RESOURCE_DESC {ITEM_RESOURCE_LEN, 0, 0}, {ITEM_RESOURCE, 0, 0}
 
 /**
- * These constants are used to determine the UPDATE covenant items.
+ * Covenant items by covenant type, in serialization order. Each
+ * list ends with an ITEM_END descriptor. Names that are not items
+ * are sent last, so they can be checked against the name hash.
  */
-#define UPDATE_RESOURCE_LEN 0x02
-#define UPDATE_RESOURCE 0x03
-#define UPDATE_NAME 0x04
+static const item_desc_t cov_items[HNS_REVOKE + 1][HNS_MAX_COV_ITEMS + 1] = {
+  [HNS_NONE] = {
+    {ITEM_END, 0, 0}
+  },
+  [HNS_CLAIM] = {
+    NAME_HASH_DESC(hns_claim_t),
+    HEIGHT_DESC(hns_claim_t),
+    NAME_DESC,
+    FIXED_DESC(hns_claim_t, flags),
+    FIXED_DESC(hns_claim_t, commit_hash),
+    FIXED_DESC(hns_claim_t, commit_height)
+  },
+  [HNS_OPEN] = {
+    NAME_HASH_DESC(hns_open_t),
+    HEIGHT_DESC(hns_open_t),
+    NAME_DESC
+  },
+  [HNS_BID] = {
+    NAME_HASH_DESC(hns_bid_t),
+    HEIGHT_DESC(hns_bid_t),
+    NAME_DESC,
+    FIXED_DESC(hns_bid_t, hash)
+  },
+  [HNS_REVEAL] = {
+    NAME_HASH_DESC(hns_reveal_t),
+    HEIGHT_DESC(hns_reveal_t),
+    FIXED_DESC(hns_reveal_t, nonce),
+    NAME_CHECK_DESC(hns_reveal_t)
+  },
+  [HNS_REDEEM] = {
+    NAME_HASH_DESC(hns_redeem_t),
+    HEIGHT_DESC(hns_redeem_t),
+    NAME_CHECK_DESC(hns_redeem_t)
+  },
+  [HNS_REGISTER] = {
+    NAME_HASH_DESC(hns_register_t),
+    HEIGHT_DESC(hns_register_t),
+    RESOURCE_DESC,
+    FIXED_DESC(hns_register_t, hash),
+    NAME_CHECK_DESC(hns_register_t)
+  },
+  [HNS_UPDATE] = {
+    NAME_HASH_DESC(hns_update_t),
+    HEIGHT_DESC(hns_update_t),
+    RESOURCE_DESC,
+    NAME_CHECK_DESC(hns_update_t)
+  },
+  [HNS_RENEW] = {
+    NAME_HASH_DESC(hns_renew_t),
+    HEIGHT_DESC(hns_renew_t),
+    FIXED_DESC(hns_renew_t, hash),
+    NAME_CHECK_DESC(hns_renew_t)
+  },
+  [HNS_TRANSFER] = {
+    NAME_HASH_DESC(hns_transfer_t),
+    HEIGHT_DESC(hns_transfer_t),
+    FIXED_DESC(hns_transfer_t, addr_ver),
+    {ITEM_ADDR, 32, offsetof(hns_transfer_t, addr_len)},
+    NAME_CHECK_DESC(hns_transfer_t)
+  },
+  [HNS_FINALIZE] = {
+    NAME_HASH_DESC(hns_finalize_t),
+    HEIGHT_DESC(hns_finalize_t),
+    NAME_DESC,
+    FIXED_DESC(hns_finalize_t, flags),
+    FIXED_DESC(hns_finalize_t, claim_height),
+    FIXED_DESC(hns_finalize_t, renewal_count),
+    FIXED_DESC(hns_finalize_t, hash)
+  },
+  [HNS_REVOKE] = {
+    NAME_HASH_DESC(hns_revoke_t),
+    HEIGHT_DESC(hns_revoke_t),
+    NAME_CHECK_DESC(hns_revoke_t)
+  }
+};
+
+/* Commitment used in place of hashes excluded by the sighash type. */
+static const uint8_t zero_hash[32] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Context used to handle the device's UI. */
+static ledger_ui_ctx_t *ui = NULL;
+
+/* Context used to handle parsing and signing state. */
+static hns_tx_t * const ctx = &g_hns_sign.tx;
+
+/* General purpose hashing context. */
+static ledger_blake2b_ctx * const blake1 = &g_hns_sign.tx_hash1;
+
+/* General purpose hashing context. */
+static ledger_blake2b_ctx * const blake2 = &g_hns_sign.tx_hash2;
 
 /**
- * These constants are used to determine the RENEW covenant items.
+ * Adds output data to the outputs hash context. Unless only
+ * a single output is parsed, the data is also added to the
+ * txid hash context.
+ *
+ * In:
+ * @param data is the output data.
+ * @param data_sz is the length of the output data.
+ *
+ * Out:
+ * @param outs is the outputs hash context.
  */
-#define RENEW_HASH 0x02
-#define RENEW_NAME 0x03
+static inline void
+hash_output(
+  ledger_blake2b_ctx *outs,
+  volatile void const *data,
+  size_t data_sz
+) {
+  ledger_blake2b_update(outs, data, data_sz);
+
+  if (!ctx->anyonecanpay)
+    ledger_blake2b_update(&ctx->txid_hash, data, data_sz);
+}
 
 /**
- * These constants are used to determine the TRANSFER covenant items.
+ * Adds a varint to the txid hash context.
+ *
+ * In:
+ * @param val is the varint's value.
  */
-#define ADDRESS_VER 0x02
-#define ADDRESS_HASH 0x03
-#define TRANSFER_NAME 0x04
+static inline void
+hash_txid_varint(hns_varint_t val) {
+  uint8_t buf[5];
+  volatile uint8_t *b = buf;
+  uint8_t sz = write_varint(&b, val);
+
+  ledger_blake2b_update(&ctx->txid_hash, buf, sz);
+}
 
 /**
- * These constants are used to determine the FINALIZE covenant items.
+ * Parses a change output's index, address version, and derivation
+ * path. The address hash is derived from the device's key so the
+ * output can later be verified without on-screen confirmation.
+ *
+ * Out:
+ * @param buf is the input buffer.
+ * @param len is the length of the input buffer.
+ * @param change is the parsed change output.
  */
-#define FINALIZE_NAME 0x02
-#define FLAGS 0x03
-#define CLAIM_HEIGHT 0x04
-#define RENEWAL_COUNT 0x05
-#define FINALIZE_HASH 0x06
+static inline void
+parse_change(volatile uint8_t **buf, uint16_t *len, hns_change_t *change) {
+  uint32_t path[HNS_MAX_DEPTH];
+  uint8_t depth;
+  uint8_t key[33];
+  uint8_t path_info = 0;
+
+  if (!read_u8(buf, len, &change->index))
+    THROW(HNS_CANNOT_READ_CHANGE_OUTPUT_INDEX);
+
+  if (change->index >= ctx->outs_len)
+    THROW(HNS_INCORRECT_CHANGE_OUTPUT_INDEX);
+
+  if (!read_u8(buf, len, &change->ver))
+    THROW(HNS_CANNOT_READ_ADDR_VERSION);
+
+  if (!read_bip44_path(buf, len, &depth, path, &path_info))
+    THROW(HNS_CANNOT_READ_BIP44_PATH);
+
+  if (path_info & HNS_BIP44_NON_ADDR)
+    THROW(HNS_INCORRECT_ADDR_PATH);
+
+  ledger_ecdsa_derive_pubkey(path, depth, key);
+
+  if (ledger_blake2b(key, sizeof(key), change->hash, sizeof(change->hash)))
+    THROW(HNS_CANNOT_INIT_BLAKE2B_CTX);
+}
 
 /**
- * These constants are used to determine the REVOKE covenant items.
+ * Reads a prevout. If compact prevouts are enabled, the prevout
+ * starts with a tag byte. The tag is either PREVOUT_LITERAL, followed
+ * by the txid, or the txid table entry holding the txid. Literal txids
+ * replace table entries in round-robin order. The output index follows.
+ * Nothing is read unless the entire prevout is in the buffer.
+ *
+ * In:
+ * @param compact indicates if compact prevouts are enabled.
+ *
+ * Out:
+ * @param buf is the input buffer.
+ * @param len is the length of the input buffer.
+ * @param prev is the prevout.
+ * @returns a boolean indicating success or failure.
  */
-#define REVOKE_NAME 0x02
+static inline bool
+read_prevout(
+  volatile uint8_t **buf,
+  uint16_t *len,
+  uint8_t *prev,
+  bool compact
+) {
+  uint8_t tag;
 
-/* Context used to handle the device's UI. */
-static ledger_ui_ctx_t *ui = NULL;
+  if (!compact)
+    return read_bytes(buf, len, prev, 36);
 
-/* Context used to handle parsing and signing state. */
-static hns_tx_t ctx;
+  if (*len < 1)
+    return false;
 
-/* General purpose hashing context. */
-static ledger_blake2b_ctx blake1;
+  tag = (*buf)[0];
 
-/* General purpose hashing context. */
-static ledger_blake2b_ctx blake2;
+  if (tag == PREVOUT_LITERAL) {
+    if (*len < 37)
+      return false;
+
+    read_u8(buf, len, &tag);
+    read_bytes(buf, len, prev, 36);
+    memmove(ctx->txids[ctx->txids_next], prev, 32);
+
+    ctx->txids_next = (ctx->txids_next + 1) % HNS_TXID_TABLE_SIZE;
+
+    if (ctx->txids_len < HNS_TXID_TABLE_SIZE)
+      ctx->txids_len++;
+
+    return true;
+  }
+
+  if (*len < 5)
+    return false;
+
+  if (tag >= ctx->txids_len)
+    THROW(HNS_INCORRECT_PREVOUT_REF);
+
+  read_u8(buf, len, &tag);
+  memmove(prev, ctx->txids[tag], 32);
+  read_bytes(buf, len, prev + 32, 4);
+  return true;
+}
+
+/**
+ * Writes the P2PKH redeem script, including its varint length,
+ * for the key at the provided derivation path. The script is
+ * OP_DUP OP_BLAKE160 <hash> OP_EQUALVERIFY OP_CHECKSIG.
+ *
+ * In:
+ * @param path is the HD path of the key.
+ * @param depth is the number of levels in the path.
+ *
+ * Out:
+ * @param script is the serialized script (26 bytes).
+ */
+static inline void
+write_p2pkh_script(uint32_t *path, uint8_t depth, uint8_t *script) {
+  uint8_t key[33];
+
+  ledger_ecdsa_derive_pubkey(path, depth, key);
+
+  script[0] = 0x19; /* script length */
+  script[1] = 0x76; /* OP_DUP */
+  script[2] = 0xc0; /* OP_BLAKE160 */
+  script[3] = 0x14; /* push 20 bytes */
+
+  if (ledger_blake2b(key, sizeof(key), script + 4, 20))
+    THROW(HNS_CANNOT_INIT_BLAKE2B_CTX);
+
+  script[24] = 0x88; /* OP_EQUALVERIFY */
+  script[25] = 0xac; /* OP_CHECKSIG */
+}
+
+/**
+ * Appends script bytes to the script being stored in the
+ * session's script pool, if any. The script is added to the
+ * pool once all of its bytes have been written.
+ *
+ * In:
+ * @param buf is the script data.
+ * @param len is the length of the script data.
+ * @param remaining is the # of script bytes left after buf.
+ */
+static inline void
+store_script(volatile uint8_t *buf, uint16_t len, hns_varint_t remaining) {
+  hns_script_pool_t *pool = &ctx->scripts;
+
+  if (!pool->storing)
+    return;
+
+  memmove(pool->data + pool->size, (uint8_t *)buf, len);
+  pool->size += len;
+
+  if (remaining == 0) {
+    pool->offset[++pool->len] = pool->size;
+    pool->storing = false;
+  }
+}
+
+/**
+ * Asserts that the sighash type is allowed in ANYONECANPAY
+ * mode, i.e. ANYONECANPAY | SINGLE or SINGLEREVERSE.
+ *
+ * In:
+ * @param type is the first byte of the sighash type.
+ */
+static inline void
+check_anyonecanpay(uint8_t type) {
+  uint8_t low = type & 0x1f;
+
+  if ((type & 0xe0) != SIGHASH_ANYONECANPAY)
+    THROW(HNS_INCORRECT_SIGHASH_TYPE);
+
+  if (low != SIGHASH_SINGLE && low != SIGHASH_SINGLEREVERSE)
+    THROW(HNS_INCORRECT_SIGHASH_TYPE);
+}
 
 /**
  * Parses an item from the covenant items list
@@ -171,9 +472,9 @@ parse_item(
   if (item_len != item_sz)
     THROW(HNS_INCORRECT_PARSER_STATE);
 
-  ledger_blake2b_update(hash, &item_len, 1);
-  ledger_blake2b_update(hash, item, item_len);
-  ctx.next_item++;
+  hash_output(hash, &item_len, 1);
+  hash_output(hash, item, item_len);
+  ctx->next_item++;
   return true;
 }
 
@@ -204,11 +505,11 @@ parse_addr(
   if (!read_varbytes(buf, len, a, 32, (size_t *)&alen))
     return false;
 
-  ledger_blake2b_update(hash, &alen, 1);
-  ledger_blake2b_update(hash, a, alen);
+  hash_output(hash, &alen, 1);
+  hash_output(hash, a, alen);
   memmove(addr_hash, a, alen);
   *addr_len = alen;
-  ctx.next_item++;
+  ctx->next_item++;
   return true;
 }
 
@@ -216,6 +517,8 @@ parse_addr(
  * Parses a name from the covenant items list
  * and adds it to the provided hash context. Upon
  * completion, the item counter is increased.
+ * If names are sent in place of name hashes, the
+ * name is not read again.
  *
  * Out:
  * @param buf is the input buffer.
@@ -236,6 +539,14 @@ parse_name(
   uint8_t n[64];
   uint8_t nlen;
 
+  /* The name was already sent in place of the name hash. */
+  if (ctx->compact_names) {
+    hash_output(hash, name_len, 1);
+    hash_output(hash, name, *name_len);
+    ctx->next_item++;
+    return true;
+  }
+
   if (!read_varbytes(buf, len, n, 63, (size_t *)&nlen))
     return false;
 
@@ -243,18 +554,20 @@ parse_name(
     THROW(HNS_INCORRECT_NAME_LEN);
 
   n[nlen] = '\0';
-  ledger_blake2b_update(hash, &nlen, 1);
-  ledger_blake2b_update(hash, n, nlen);
+  hash_output(hash, &nlen, 1);
+  hash_output(hash, n, nlen);
   strcpy(name, (char *)n);
   *name_len = nlen;
-  ctx.next_item++;
+  ctx->next_item++;
   return true;
 }
 
 /**
  * Parses a name from the serialized tx and
  * compares it against the name hash in the
- * covenant items list.
+ * covenant items list. If names are sent in
+ * place of name hashes, there is nothing to
+ * compare.
  *
  * In:
  * @param name_hash is the sha3 hash of the name.
@@ -278,6 +591,12 @@ cmp_name(
   size_t nlen;
   uint8_t digest[32];
 
+  /* The name hash was computed from the name. */
+  if (ctx->compact_names) {
+    ctx->next_item++;
+    return true;
+  }
+
   if (!read_varbytes(buf, len, n, 63, &nlen))
     return false;
 
@@ -293,20 +612,68 @@ cmp_name(
   n[nlen] = '\0';
   strcpy(name, (char *)n);
   *name_len = nlen;
-  ctx.next_item++;
+  ctx->next_item++;
+  return true;
+}
+
+/**
+ * Parses the name hash from the covenant items list
+ * and adds it to the provided hash context. If names
+ * are sent in place of name hashes, the name is parsed
+ * and its sha3 hash is added instead. Upon completion,
+ * the item counter is increased.
+ *
+ * Out:
+ * @param buf is the input buffer.
+ * @param len is the length of the input buffer.
+ * @param name_hash is the parsed name hash.
+ * @param cov is the covenant holding the name.
+ * @param hash is the blake2b hash context.
+ * @returns a boolean indicating success or failure.
+ */
+static inline bool
+parse_name_hash(
+  volatile uint8_t **buf,
+  uint16_t *len,
+  uint8_t *name_hash,
+  hns_cov_t *cov,
+  ledger_blake2b_ctx *hash
+) {
+  uint8_t n[64];
+  size_t nlen;
+  uint8_t hash_len = 32;
+
+  if (!ctx->compact_names)
+    return parse_item(buf, len, name_hash, 32, hash);
+
+  if (!read_varbytes(buf, len, n, 63, &nlen))
+    return false;
+
+  if (nlen < 1 || nlen > 63)
+    THROW(HNS_INCORRECT_NAME_LEN);
+
+  if (!ledger_sha3(n, nlen, name_hash))
+    THROW(HNS_CANNOT_CREATE_COVENANT_NAME_HASH);
+
+  hash_output(hash, &hash_len, 1);
+  hash_output(hash, name_hash, 32);
+  n[nlen] = '\0';
+  strcpy(cov->name, (char *)n);
+  cov->name_len = nlen;
+  ctx->next_item++;
   return true;
 }
 
 /**
  * Parses the length of the resource bytes from
  * the covenant items list and adds it to the
- * hash context. Upon completion, the item counter
- * is increased.
+ * hash context. The resource decoder is reset.
+ * Upon completion, the item counter is increased.
  *
  * Out:
  * @param buf is the input buffer.
  * @param len is the length of the input buffer.
- * @param ctr is the length of the resource.
+ * @param cov is the covenant holding the resource.
  * @param hash is the blake2b hash context.
  * @returns a boolean indicating success or failure.
  */
@@ -314,32 +681,40 @@ static inline bool
 parse_resource_len(
   volatile uint8_t **buf,
   uint16_t *len,
-  hns_varint_t *ctr,
+  hns_cov_t *cov,
   ledger_blake2b_ctx *hash
 ) {
+  hns_varint_t *ctr = &cov->resource_ctr;
+
   if (!peek_varint(buf, len, ctr))
     return false;
 
+  if (*ctr > HNS_RESOURCE_MAX_SIZE)
+    THROW(HNS_INCORRECT_RESOURCE_LEN);
+
   uint8_t res_len[5] = {0};
   uint8_t res_len_size = size_varint(*ctr);
 
   if (!read_bytes(buf, len, res_len, res_len_size))
     THROW(HNS_CANNOT_READ_RESOURCE_LEN);
 
-  ledger_blake2b_update(hash, res_len, res_len_size);
-  ctx.next_item++;
+  hash_output(hash, res_len, res_len_size);
+  hns_resource_init(&cov->resource);
+  ctx->next_item++;
   return true;
 }
 
 /**
  * Parses resource bytes from the covenant
  * items list and adds them to the hash context.
+ * The bytes are decoded as they stream through,
+ * so the resource can be summarized on-screen.
  * Upon completion, the item counter is increased.
  *
  * Out:
  * @param buf is the input buffer.
  * @param len is the length of the input buffer.
- * @param ctr is the length of the resource.
+ * @param cov is the covenant holding the resource.
  * @param hash is the blake2b hash context.
  * @returns a boolean indicating success or failure.
  */
@@ -347,16 +722,20 @@ static inline bool
 parse_resource(
   volatile uint8_t **buf,
   uint16_t *len,
-  hns_varint_t *ctr,
+  hns_cov_t *cov,
   ledger_blake2b_ctx *hash
 ) {
+  hns_varint_t *ctr = &cov->resource_ctr;
   hns_varint_t length = *ctr;
 
   if (*ctr > 0) {
     if (*ctr > *len)
       length = *len;
 
-    ledger_blake2b_update(hash, *buf, length);
+    hash_output(hash, *buf, length);
+
+    if (!hns_resource_update(&cov->resource, *buf, length))
+      THROW(HNS_INCORRECT_RESOURCE);
 
     *buf += length;
     *len -= length;
@@ -370,10 +749,66 @@ parse_resource(
     }
   }
 
-  ctx.next_item++;
+  if (!hns_resource_complete(&cov->resource))
+    THROW(HNS_INCORRECT_RESOURCE);
+
+  ctx->next_item++;
   return true;
 }
 
+/**
+ * Parses the covenant item described by the provided descriptor.
+ * Upon completion, the item counter is increased.
+ *
+ * In:
+ * @param desc is the item descriptor.
+ *
+ * Out:
+ * @param buf is the input buffer.
+ * @param len is the length of the input buffer.
+ * @param cov is the covenant holding the item.
+ * @param hash is the blake2b hash context.
+ * @returns a boolean indicating success or failure.
+ */
+static inline bool
+parse_cov_item(
+  volatile uint8_t **buf,
+  uint16_t *len,
+  const item_desc_t *desc,
+  hns_cov_t *cov,
+  ledger_blake2b_ctx *hash
+) {
+  uint8_t *item = (uint8_t *)&cov->items + desc->offset;
+
+  switch(desc->kind) {
+    case ITEM_FIXED:
+      return parse_item(buf, len, item, desc->size, hash);
+
+    case ITEM_NAME_HASH:
+      return parse_name_hash(buf, len, item, cov, hash);
+
+    case ITEM_NAME:
+      return parse_name(buf, len, cov->name, &cov->name_len, hash);
+
+    case ITEM_NAME_CHECK:
+      return cmp_name(buf, len, item, cov->name, &cov->name_len);
+
+    case ITEM_ADDR:
+      return parse_addr(buf, len, item + 1, item, hash);
+
+    case ITEM_RESOURCE_LEN:
+      return parse_resource_len(buf, len, cov, hash);
+
+    case ITEM_RESOURCE:
+      return parse_resource(buf, len, cov, hash);
+
+    default:
+      THROW(HNS_INCORRECT_PARSER_STATE);
+  }
+
+  return false;
+}
+
 /**
  * Parses transactions details & begins sighash. Will require
  * more than one message for serialized transactions longer
@@ -398,10 +833,12 @@ parse(
   volatile uint8_t *flags
 ) {
   hns_input_t in;
-  hns_output_t *out = &ctx.curr_output;
-  ledger_blake2b_ctx *prevs = &blake1;
-  ledger_blake2b_ctx *seqs = &blake2;
-  ledger_blake2b_ctx *outs = &blake2; /* Re-initialized before use. */
+  hns_output_t *out = &ctx->curr_output;
+  uint8_t res_len = 0;
+  ledger_blake2b_ctx *prevs = blake1;
+  ledger_blake2b_ctx *seqs = blake2;
+  ledger_blake2b_ctx *outs = blake2; /* Re-initialized before use. */
+  ledger_blake2b_ctx *txid = &ctx->txid_hash;
 
   /**
    * If this is an initial APDU message, clear
@@ -409,58 +846,63 @@ parse(
    */
 
   if (p1 & P1_INIT_MASK) {
-    ledger_apdu_cache_clear();
+    ledger_apdu_cache_clear(LEDGER_APDU_CACHE_TX);
 
-    memset(&ctx, 0, sizeof(hns_tx_t));
+    memset(ctx, 0, sizeof(hns_tx_t));
+    g_hns_sign.owner = HNS_SIGN_OWNER_TX;
+    ctx->must_confirm = true;
+    ctx->compact_names = (p1 & P1_COMPACT_NAME_MASK) != 0;
+    ctx->compact_prevs = (p1 & P1_COMPACT_PREV_MASK) != 0;
 
-    if (!read_bytes(&buf, len, ctx.ver, sizeof(ctx.ver)))
+    if (!read_bytes(&buf, len, ctx->ver, sizeof(ctx->ver)))
       THROW(HNS_CANNOT_READ_TX_VERSION);
 
-    if (!read_bytes(&buf, len, ctx.locktime, sizeof(ctx.locktime)))
+    if (!read_bytes(&buf, len, ctx->locktime, sizeof(ctx->locktime)))
       THROW(HNS_CANNOT_READ_TX_LOCKTIME);
 
-    if (!read_u8(&buf, len, &ctx.ins_len))
+    if (!read_u8(&buf, len, &ctx->ins_len))
       THROW(HNS_CANNOT_READ_INPUTS_LEN);
 
-    if (!read_u8(&buf, len, &ctx.outs_len))
+    if (!read_u8(&buf, len, &ctx->outs_len))
       THROW(HNS_CANNOT_READ_OUTPUTS_LEN);
 
     /**
      * Read change address info. If the change flag is 0x01, we must parse the
      * change output's index, and the corresponding address's version and
-     * derivation path. Otherwise, we move on to the input data.
+     * derivation path. If the change flag is 0x03, the same details are
+     * parsed for a list of change outputs, sorted by output index.
+     * Otherwise, we move on to the input data.
      *
-     * Due to a max derivation depth of 5, all change address information
-     * should fit within the first parsing message. Unknown flag values will
-     * throw an error.
+     * Due to a max derivation depth of 5, and a max of 4 change outputs,
+     * all change address information should fit within the first parsing
+     * message. Unknown flag values will throw an error.
      */
 
-    if (!read_u8(&buf, len, &ctx.change_flag))
+    if (!read_u8(&buf, len, &ctx->change_flag))
       THROW(HNS_CANNOT_READ_CHANGE_ADDR_FLAG);
 
-    switch(ctx.change_flag) {
+    switch(ctx->change_flag) {
       case P2PKH_CHANGE_ADDR: {
-        ledger_ecdsa_xpub_t xpub;
-        uint8_t path_info = 0;
-
-        if (!read_u8(&buf, len, &ctx.change_index))
-          THROW(HNS_CANNOT_READ_CHANGE_OUTPUT_INDEX);
-
-        if (!read_u8(&buf, len, &ctx.change.ver))
-          THROW(HNS_CANNOT_READ_ADDR_VERSION);
+        ctx->change_len = 1;
+        parse_change(&buf, len, &ctx->change[0]);
+        break;
+      }
 
-        if (!read_bip44_path(&buf, len, &xpub.depth, xpub.path, &path_info))
-          THROW(HNS_CANNOT_READ_BIP44_PATH);
+      case MULTI_P2PKH_CHANGE_ADDR: {
+        uint8_t i;
 
-        if (path_info & HNS_BIP44_NON_ADDR)
-          THROW(HNS_INCORRECT_ADDR_PATH);
+        if (!read_u8(&buf, len, &ctx->change_len))
+          THROW(HNS_CANNOT_READ_CHANGE_OUTPUTS_LEN);
 
-        ledger_ecdsa_derive_xpub(&xpub);
+        if (ctx->change_len < 1 || ctx->change_len > HNS_MAX_CHANGE_OUTPUTS)
+          THROW(HNS_INCORRECT_CHANGE_OUTPUTS_LEN);
 
-        if (ledger_blake2b(xpub.key, 33, ctx.change.hash, 20))
-          THROW(HNS_CANNOT_INIT_BLAKE2B_CTX);
+        for (i = 0; i < ctx->change_len; i++) {
+          parse_change(&buf, len, &ctx->change[i]);
 
-        ctx.change.hash_len = 20;
+          if (i > 0 && ctx->change[i].index <= ctx->change[i - 1].index)
+            THROW(HNS_INCORRECT_CHANGE_OUTPUT_INDEX);
+        }
 
         break;
       }
@@ -473,8 +915,31 @@ parse(
         THROW(HNS_INCORRECT_CHANGE_ADDR_FLAG);
     }
 
-    ledger_blake2b_init(prevs, 32);
-    ledger_blake2b_init(seqs, 32);
+    /**
+     * In ANYONECANPAY mode, only the output to be signed is parsed and
+     * confirmed. The sighash does not commit to the other inputs or
+     * outputs, so the client sends no inputs, a single output, and no
+     * change address. Signature requests are then restricted to the
+     * ANYONECANPAY | SINGLE and ANYONECANPAY | SINGLEREVERSE types.
+     */
+
+    if (p1 & P1_ANYONECANPAY_MASK) {
+      if (ctx->ins_len != 0 || ctx->outs_len != 1)
+        THROW(HNS_INCORRECT_PARSER_STATE);
+
+      if (ctx->change_flag != NO_CHANGE_ADDR)
+        THROW(HNS_INCORRECT_CHANGE_ADDR_FLAG);
+
+      ctx->anyonecanpay = true;
+      ctx->next_field = OUTPUT_VALUE;
+      ledger_blake2b_init(outs, 32);
+    } else {
+      ledger_blake2b_init(prevs, 32);
+      ledger_blake2b_init(seqs, 32);
+      ledger_blake2b_init(txid, 32);
+      ledger_blake2b_update(txid, ctx->ver, sizeof(ctx->ver));
+      hash_txid_varint(ctx->ins_len);
+    }
   }
 
   /**
@@ -482,21 +947,21 @@ parse(
    * the apdu buffer with any data left in the cache.
    */
 
-  if (ctx.ins_ctr == ctx.ins_len)
-    if (ctx.next_field < OUTPUT_VALUE)
+  if (ctx->ins_ctr == ctx->ins_len)
+    if (ctx->next_field < OUTPUT_VALUE)
       THROW(HNS_INCORRECT_PARSER_STATE);
 
-  if (ctx.ins_ctr > ctx.ins_len)
+  if (ctx->ins_ctr > ctx->ins_len)
     THROW(HNS_INCORRECT_PARSER_STATE);
 
-  if (ctx.outs_ctr == ctx.outs_len)
-    if (ctx.next_field <= COVENANT_ITEMS)
+  if (ctx->outs_ctr == ctx->outs_len)
+    if (ctx->next_field <= COVENANT_ITEMS)
       THROW(HNS_INCORRECT_PARSER_STATE);
 
-  if (ctx.outs_ctr > ctx.outs_len)
+  if (ctx->outs_ctr > ctx->outs_len)
     THROW(HNS_INCORRECT_PARSER_STATE);
 
-  ledger_apdu_cache_flush(len);
+  ledger_apdu_cache_flush(LEDGER_APDU_CACHE_TX, len);
 
   /**
    * Parse the transaction details.
@@ -505,13 +970,14 @@ parse(
   for (;;) {
     bool should_continue = false;
 
-    switch(ctx.next_field) {
+    switch(ctx->next_field) {
       case PREVOUT: {
-        if (!read_bytes(&buf, len, in.prev, sizeof(in.prev)))
+        if (!read_prevout(&buf, len, in.prev, ctx->compact_prevs))
           break;
 
         ledger_blake2b_update(prevs, in.prev, sizeof(in.prev));
-        ctx.next_field++;
+        ledger_blake2b_update(txid, in.prev, sizeof(in.prev));
+        ctx->next_field++;
       }
 
       case SEQUENCE: {
@@ -519,28 +985,38 @@ parse(
           break;
 
         ledger_blake2b_update(seqs, in.seq, sizeof(in.seq));
-        ctx.next_field++;
+        ledger_blake2b_update(txid, in.seq, sizeof(in.seq));
+        ctx->next_field++;
       }
 
+      /**
+       * Fees are only confirmed for SIGHASH_ALL, so they are
+       * not tracked in ANYONECANPAY mode, where outputs may
+       * legitimately exceed the inputs.
+       */
+
       case INPUT_VALUE: {
-        uint8_t val[8];
+        hns_amount_t val;
 
-        if (!read_bytes(&buf, len, val, 8))
+        if (!read_u64(&buf, len, &val, HNS_LE))
           break;
 
-        add_u64(ctx.fees, ctx.fees, val);
-        ctx.next_field++;
+        if (!ctx->anyonecanpay && !add_amount(&ctx->fees, ctx->fees, val))
+          THROW(HNS_INPUT_VALUE_OVERFLOW);
 
-        if (++ctx.ins_ctr < ctx.ins_len) {
+        ctx->next_field++;
+
+        if (++ctx->ins_ctr < ctx->ins_len) {
           memset(&in, 0, sizeof(hns_input_t));
-          ctx.next_field = PREVOUT;
+          ctx->next_field = PREVOUT;
           should_continue = true;
           break;
         }
 
-        ledger_blake2b_final(prevs, ctx.prevs);
-        ledger_blake2b_final(seqs, ctx.seqs);
+        ledger_blake2b_final(prevs, ctx->prevs);
+        ledger_blake2b_final(seqs, ctx->seqs);
         ledger_blake2b_init(outs, 32);
+        hash_txid_varint(ctx->outs_len);
       }
 
       /**
@@ -549,14 +1025,19 @@ parse(
        */
 
       case OUTPUT_VALUE: {
-        uint8_t *val = out->val;
+        hns_amount_t *val = &out->val;
+        uint8_t val_le[8];
+        volatile uint8_t *v = val_le;
 
-        if (!read_bytes(&buf, len, val, 8))
+        if (!read_u64(&buf, len, val, HNS_LE))
           break;
 
-        sub_u64(ctx.fees, ctx.fees, val);
-        ledger_blake2b_update(outs, val, 8);
-        ctx.next_field++;
+        if (!ctx->anyonecanpay && !sub_amount(&ctx->fees, ctx->fees, *val))
+          THROW(HNS_OUTPUT_VALUE_OVERFLOW);
+
+        write_u64(&v, *val, HNS_LE);
+        hash_output(outs, val_le, sizeof(val_le));
+        ctx->next_field++;
       }
 
       case ADDR_VERSION: {
@@ -565,8 +1046,8 @@ parse(
         if (!read_u8(&buf, len, ver))
           break;
 
-        ledger_blake2b_update(outs, ver, 1);
-        ctx.next_field++;
+        hash_output(outs, ver, 1);
+        ctx->next_field++;
       }
 
       case ADDR_HASH_LEN: {
@@ -575,8 +1056,8 @@ parse(
         if (!read_u8(&buf, len, hash_len))
           break;
 
-        ledger_blake2b_update(outs, hash_len, 1);
-        ctx.next_field++;
+        hash_output(outs, hash_len, 1);
+        ctx->next_field++;
       }
 
       case ADDR_HASH: {
@@ -585,8 +1066,8 @@ parse(
         if (!read_bytes(&buf, len, addr->hash, addr->hash_len))
           break;
 
-        ledger_blake2b_update(outs, addr->hash, addr->hash_len);
-        ctx.next_field++;
+        hash_output(outs, addr->hash, addr->hash_len);
+        ctx->next_field++;
       }
 
       case COVENANT_TYPE: {
@@ -595,8 +1076,8 @@ parse(
         if (!read_u8(&buf, len, type))
           break;
 
-        ledger_blake2b_update(outs, type, 1);
-        ctx.next_field++;
+        hash_output(outs, type, 1);
+        ctx->next_field++;
       }
 
       case COVENANT_ITEMS_LEN: {
@@ -611,8 +1092,8 @@ parse(
         if (!read_bytes(&buf, len, items_len_buf, items_len_size))
           THROW(HNS_CANNOT_READ_COVENANT_ITEMS_LEN);
 
-        ledger_blake2b_update(outs, items_len_buf, items_len_size);
-        ctx.next_field++;
+        hash_output(outs, items_len_buf, items_len_size);
+        ctx->next_field++;
       }
 
      /**
@@ -624,286 +1105,61 @@ parse(
       *
       * Note: the name is not included in the output commitment unless it is
       * a part of the covenant's items list.
+      *
+      * With compact names, the client sends the name in place of the name
+      * hash. The name hash is computed on-device, so the name is neither
+      * sent twice nor verified.
       */
 
       case COVENANT_ITEMS: {
-        switch(out->cov.type) {
-          case HNS_NONE:
-            break;
+        hns_cov_t *c = &out->cov;
 
-          /**
-           * For each subsequent case, the internal
-           * switch fall-throughs are intentional.
-           */
-          case HNS_OPEN: {
-            hns_cov_t *c = &out->cov;
-            hns_open_t *o = &c->items.open;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, o->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, o->height, 4, outs))
-                  goto inner_break;
-
-              case OPEN_NAME:
-                if (!parse_name(&buf, len, c->name, &c->name_len, outs))
-                  goto inner_break;
-            }
-            break;
-          }
+        if (c->type > HNS_REVOKE)
+          THROW(HNS_UNSUPPORTED_COVENANT_TYPE);
 
-          case HNS_BID: {
-            hns_cov_t *c = &out->cov;
-            hns_bid_t *b = &c->items.bid;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, b->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, b->height, 4, outs))
-                  goto inner_break;
-
-              case BID_NAME:
-                if (!parse_name(&buf, len, c->name, &c->name_len, outs))
-                  goto inner_break;
-
-              case BID_HASH:
-                if (!parse_item(&buf, len, b->hash, 32, outs))
-                  goto inner_break;
-            }
-            break;
-          }
-
-          case HNS_REVEAL: {
-            hns_cov_t *c = &out->cov;
-            hns_reveal_t *r = &c->items.reveal;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, r->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, r->height, 4, outs))
-                  goto inner_break;
-
-              case REVEAL_NONCE:
-                if (!parse_item(&buf, len, r->nonce, 32, outs))
-                  goto inner_break;
-
-              case REVEAL_NAME:
-                if (!cmp_name(&buf, len, r->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
-
-          case HNS_REDEEM: {
-            hns_cov_t *c = &out->cov;
-            hns_redeem_t *r = &c->items.redeem;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, r->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, r->height, 4, outs))
-                  goto inner_break;
-
-              case REDEEM_NAME:
-                if (!cmp_name(&buf, len, r->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
-
-          case HNS_REGISTER: {
-            hns_cov_t *c = &out->cov;
-            hns_register_t *r = &c->items.register_cov;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, r->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, r->height, 4, outs))
-                  goto inner_break;
-
-              case REGISTER_RESOURCE_LEN:
-                if (!parse_resource_len(&buf, len, &r->resource_ctr, outs))
-                  goto inner_break;
-
-              case REGISTER_RESOURCE:
-                if (!parse_resource(&buf, len, &r->resource_ctr, outs))
-                  goto inner_break;
-
-              case REGISTER_HASH:
-                if (!parse_item(&buf, len, r->hash, 32, outs))
-                  goto inner_break;
-
-              case REGISTER_NAME:
-                if (!cmp_name(&buf, len, r->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
-
-          case HNS_UPDATE: {
-            hns_cov_t *c = &out->cov;
-            hns_update_t *u = &c->items.update;
-            switch(ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, u->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, u->height, 4, outs))
-                  goto inner_break;
-
-              case UPDATE_RESOURCE_LEN:
-                if (!parse_resource_len(&buf, len, &u->resource_ctr, outs))
-                  goto inner_break;
-
-              case UPDATE_RESOURCE:
-                if (!parse_resource(&buf, len, &u->resource_ctr, outs))
-                  goto inner_break;
-
-              case UPDATE_NAME:
-                if (!cmp_name(&buf, len, u->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
+        const item_desc_t *items = cov_items[c->type];
 
-          case HNS_RENEW: {
-            hns_cov_t *c = &out->cov;
-            hns_renew_t *r = &c->items.renew;
-            switch(ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, r->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, r->height, 4, outs))
-                  goto inner_break;
-
-              case RENEW_HASH:
-                if (!parse_item(&buf, len, r->hash, 32, outs))
-                  goto inner_break;
-
-              case RENEW_NAME:
-                if (!cmp_name(&buf, len, r->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
+        while (items[ctx->next_item].kind != ITEM_END)
+          if (!parse_cov_item(&buf, len, &items[ctx->next_item], c, outs))
+            goto inner_break;
 
-          case HNS_TRANSFER: {
-            hns_cov_t *c = &out->cov;
-            hns_transfer_t *t = &c->items.transfer;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, t->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, t->height, 4, outs))
-                  goto inner_break;
-
-              case ADDRESS_VER:
-                if (!parse_item(&buf, len, &t->addr_ver, 1, outs))
-                  goto inner_break;
-
-              case ADDRESS_HASH:
-                if (!parse_addr(&buf, len, t->addr_hash, &t->addr_len, outs))
-                  goto inner_break;
-
-              case TRANSFER_NAME:
-                if (!cmp_name(&buf, len, t->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
+        /**
+         * In ANYONECANPAY mode, an output without a covenant
+         * can be used as a template for presigning auctions.
+         */
 
-          case HNS_FINALIZE: {
-            hns_cov_t *c = &out->cov;
-            hns_finalize_t *f = &c->items.finalize;
-            switch(ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, f->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, f->height, 4, outs))
-                  goto inner_break;
-
-              case FINALIZE_NAME:
-                if (!parse_name(&buf, len, c->name, &c->name_len, outs))
-                  goto inner_break;
-
-              case FLAGS:
-                if (!parse_item(&buf, len, &f->flags, 1, outs))
-                  goto inner_break;
-
-              case CLAIM_HEIGHT:
-                if (!parse_item(&buf, len, f->claim_height, 4, outs))
-                  goto inner_break;
-
-              case RENEWAL_COUNT:
-                if (!parse_item(&buf, len, f->renewal_count, 4, outs))
-                  goto inner_break;
-
-              case FINALIZE_HASH:
-                if (!parse_item(&buf, len, f->hash, 32, outs))
-                  goto inner_break;
-            }
-            break;
-          }
+        if (ctx->anyonecanpay && out->cov.type == HNS_NONE) {
+          ctx->auction.start = out->val;
+          memmove(&ctx->auction.addr, &out->addr, sizeof(hns_addr_t));
+        }
 
-          case HNS_REVOKE: {
-            hns_cov_t *c = &out->cov;
-            hns_revoke_t *r = &c->items.revoke;
-            switch (ctx.next_item) {
-              case NAME_HASH:
-                if (!parse_item(&buf, len, r->name_hash, 32, outs))
-                  goto inner_break;
-
-              case HEIGHT:
-                if (!parse_item(&buf, len, r->height, 4, outs))
-                  goto inner_break;
-
-              case REVOKE_NAME:
-                if (!cmp_name(&buf, len, r->name_hash, c->name, &c->name_len))
-                  goto inner_break;
-            }
-            break;
-          }
+        hns_change_t *change = NULL;
 
-          default:
-            THROW(HNS_UNSUPPORTED_COVENANT_TYPE);
+        if (ctx->change_ctr < ctx->change_len &&
+            ctx->change[ctx->change_ctr].index == ctx->outs_ctr) {
+          change = &ctx->change[ctx->change_ctr];
         }
 
-        if (ctx.change_flag == P2PKH_CHANGE_ADDR &&
-            ctx.change_index == ctx.outs_ctr) {
+        if (change != NULL) {
           /**
            * We need to verify that the change address details,
            * sent by the client, match a key on this device.
            */
 
-          if (out->addr.ver != ctx.change.ver)
+          if (out->addr.ver != change->ver)
             THROW(HNS_CHANGE_ADDRESS_MISMATCH);
 
-          if (out->addr.hash_len != ctx.change.hash_len)
+          if (out->addr.hash_len != sizeof(change->hash))
             THROW(HNS_CHANGE_ADDRESS_MISMATCH);
 
-          if (memcmp(out->addr.hash, ctx.change.hash, out->addr.hash_len) != 0)
+          if (memcmp(out->addr.hash, change->hash, sizeof(change->hash)) != 0)
             THROW(HNS_CHANGE_ADDRESS_MISMATCH);
 
-          if (++ctx.outs_ctr < ctx.outs_len) {
-            ctx.next_field = OUTPUT_VALUE;
-            ctx.next_item = NAME_HASH;
+          ctx->change_ctr++;
+
+          if (++ctx->outs_ctr < ctx->outs_len) {
+            ctx->next_field = OUTPUT_VALUE;
+            ctx->next_item = 0;
             should_continue = true;
             break;
           }
@@ -915,7 +1171,7 @@ parse(
            * through the output items during on-screen confirmation.
            */
 
-          ui->ctx = (void *)&ctx;
+          ui->ctx = (void *)ctx;
           ui->flags = flags;
           ui->buflen = *len;
           ui->network = p1 & P1_NETWORK_MASK;
@@ -927,21 +1183,48 @@ parse(
 
           char *hdr = "Verify";
           char *msg = ui->message;
-          snprintf(msg, 11, "Output #%d", ++(ui->ctr));
+          snprintf(msg, 11, "Output #%d", ++ctx->confirm_ctr);
 
           if (!ledger_ui_update(LEDGER_UI_OUTPUT, hdr, msg, flags))
             THROW(HNS_CANNOT_UPDATE_UI);
 
-          if (++ctx.outs_ctr < ctx.outs_len) {
-            ctx.next_field = OUTPUT_VALUE;
-            ctx.next_item = NAME_HASH;
+          if (++ctx->outs_ctr < ctx->outs_len) {
+            ctx->next_field = OUTPUT_VALUE;
+            ctx->next_item = 0;
             return ui->buflen;
           }
         }
 
-        ledger_blake2b_final(outs, ctx.outs);
-        ctx.tx_parsed = true;
-        ctx.next_field++;
+        ledger_blake2b_final(outs, ctx->outs);
+        ctx->tx_parsed = true;
+        ctx->next_field++;
+
+        /**
+         * Outputs confirmed on-screen were approved before the client
+         * could continue, so if the last output is a change output,
+         * every output has been approved. Otherwise, the last output
+         * is approved by the on-screen confirmation.
+         */
+
+        if (change != NULL)
+          ctx->outs_approved = true;
+
+        /**
+         * The txid is returned with the final response. If the last
+         * output is pending confirmation, it is sent once approved.
+         */
+
+        if (!ctx->anyonecanpay) {
+          ledger_blake2b_update(txid, ctx->locktime, sizeof(ctx->locktime));
+          ledger_blake2b_final(txid, ctx->txid);
+
+          if (change == NULL) {
+            ui->buflen += write_bytes(&res, ctx->txid, sizeof(ctx->txid));
+          } else {
+            res_len = write_bytes(&res, ctx->txid, sizeof(ctx->txid));
+          }
+        }
+
         break;
       }
 
@@ -959,13 +1242,13 @@ inner_break:
       THROW(HNS_INCORRECT_PARSER_STATE);
 
     if (*len > 0)
-      if(!ledger_apdu_cache_write(buf, *len))
+      if(!ledger_apdu_cache_write(LEDGER_APDU_CACHE_TX, buf, *len))
         THROW(HNS_INCORRECT_PARSER_STATE);
 
     break;
   }
 
-  return 0;
+  return res_len;
 };
 
 
@@ -973,7 +1256,9 @@ inner_break:
  * Parses the signing key's HD path, the sighash type, and the input details.
  * Also parses output data for single output sighash types, then returns a
  * signature for the specified input. Will require more than one message for
- * scripts longer than 182 bytes (including varint length prefix).
+ * scripts longer than 182 bytes (including varint length prefix). Selected
+ * scripts are built on-device and are never sent by the client. The signing
+ * key's pubkey can be returned with the signature to complete the witness.
  *
  * In:
  * @param p1 is the first apdu command parameter.
@@ -993,18 +1278,11 @@ sign(
   volatile uint8_t *sig,
   volatile uint8_t *flags
 ) {
-  if (!ctx.tx_parsed)
+  if (!ctx->tx_parsed)
     THROW(HNS_INCORRECT_PARSER_STATE);
 
-  const uint8_t zero_hash[32] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  };
-
-  ledger_blake2b_ctx *hash = &blake1;
-  ledger_blake2b_ctx *output = &blake2;
+  ledger_blake2b_ctx *hash = blake1;
+  ledger_blake2b_ctx *output = blake2;
   uint8_t digest[32];
 
   /**
@@ -1012,26 +1290,32 @@ sign(
    * commitments for the signature hash.
    */
 
-  hns_input_t *in = &ctx.curr_input;
+  hns_input_t *in = &ctx->curr_input;
   uint8_t *type = &in->type[0];
 
   if (p1 & P1_INIT_MASK) {
-    ledger_apdu_cache_clear();
+    ledger_apdu_cache_clear(LEDGER_APDU_CACHE_TX);
+
+    /* Any pending auction shares the signing input. */
+    ctx->auction.confirmed = false;
 
     uint8_t path_info = 0;
 
     if (!read_bip44_path(&buf, len, &in->depth, in->path, &path_info))
       THROW(HNS_CANNOT_READ_BIP44_PATH);
 
-    uint8_t non_address = path_info & HNS_BIP44_NON_ADDR;
-
-    if (non_address)
+    if (path_info & HNS_BIP44_NON_ADDR)
       THROW(HNS_INCORRECT_SIGNATURE_PATH);
 
     if (!read_bytes(&buf, len, in->type, sizeof(in->type)))
       THROW(HNS_CANNOT_READ_SIGHASH_TYPE);
 
-    if (!read_bytes(&buf, len, in->prev, sizeof(in->prev)))
+    if (ctx->anyonecanpay)
+      check_anyonecanpay(*type);
+
+    in->append_key = (p1 & P1_PUBKEY_MASK) != 0;
+
+    if (!read_prevout(&buf, len, in->prev, p1 & P1_COMPACT_PREV_MASK))
       THROW(HNS_CANNOT_READ_PREVOUT);
 
     if (!read_bytes(&buf, len, in->val, sizeof(in->val)))
@@ -1040,17 +1324,87 @@ sign(
     if (!read_bytes(&buf, len, in->seq, sizeof(in->seq)))
       THROW(HNS_CANNOT_READ_SEQUENCE);
 
-    if (!peek_varint(&buf, len, &in->script_ctr))
-      THROW(HNS_CANNOT_PEEK_SCRIPT_LEN);
+    /**
+     * If a script is selected, the device builds the script or
+     * loads it from the session's script pool, and the client does
+     * not send it. Otherwise, the script follows the input details,
+     * and may be stored in the pool for later inputs.
+     */
 
+    hns_script_pool_t *pool = &ctx->scripts;
+    uint8_t p2pkh[26];
+    uint8_t *script = NULL;
+    uint8_t script_size = 0;
     uint8_t script_len[5] = {0};
-    uint8_t script_len_size = size_varint(in->script_ctr);
+    uint8_t script_len_size = 0;
+    bool store = false;
 
-    if (!read_bytes(&buf, len, script_len, script_len_size))
-      THROW(HNS_CANNOT_READ_SCRIPT_LEN);
+    /* Discard a script left incomplete by a previous request. */
+    pool->storing = false;
+    pool->size = pool->offset[pool->len];
+
+    if (p1 & P1_SCRIPT_MASK) {
+      uint8_t selector;
+
+      if (!read_u8(&buf, len, &selector))
+        THROW(HNS_CANNOT_READ_SCRIPT_SELECTOR);
+
+      switch(selector) {
+        case SCRIPT_P2PKH:
+          write_p2pkh_script(in->path, in->depth, p2pkh);
+          script = p2pkh;
+          script_size = sizeof(p2pkh);
+          break;
 
-    uint8_t *prevs = ctx.prevs;
-    uint8_t *seqs = ctx.seqs;
+        case SCRIPT_STORE:
+          store = true;
+          break;
+
+        default: {
+          uint8_t slot = selector & ~SCRIPT_REF;
+
+          if (!(selector & SCRIPT_REF) || slot >= pool->len)
+            THROW(HNS_INCORRECT_SCRIPT_SELECTOR);
+
+          script = pool->data + pool->offset[slot];
+          script_size = pool->offset[slot + 1] - pool->offset[slot];
+          break;
+        }
+      }
+    }
+
+    if (script_size > 0) {
+      in->script_ctr = 0;
+    } else {
+      if (!peek_varint(&buf, len, &in->script_ctr))
+        THROW(HNS_CANNOT_PEEK_SCRIPT_LEN);
+
+      script_len_size = size_varint(in->script_ctr);
+
+      if (!read_bytes(&buf, len, script_len, script_len_size))
+        THROW(HNS_CANNOT_READ_SCRIPT_LEN);
+
+      if (store) {
+        /* An empty script would never be added to the pool. */
+        if (in->script_ctr == 0)
+          THROW(HNS_INCORRECT_SCRIPT_SELECTOR);
+
+        if (pool->len == HNS_MAX_SCRIPTS)
+          THROW(HNS_SCRIPT_POOL_FULL);
+
+        uint8_t avail = HNS_SCRIPT_POOL_SIZE - pool->size;
+
+        if (in->script_ctr + script_len_size > avail)
+          THROW(HNS_SCRIPT_POOL_FULL);
+
+        memmove(pool->data + pool->size, script_len, script_len_size);
+        pool->size += script_len_size;
+        pool->storing = true;
+      }
+    }
+
+    uint8_t *prevs = ctx->prevs;
+    uint8_t *seqs = ctx->seqs;
 
     if (*type & SIGHASH_ANYONECANPAY) {
       prevs = (uint8_t *)zero_hash;
@@ -1070,11 +1424,18 @@ sign(
     }
 
     ledger_blake2b_init(hash, 32);
-    ledger_blake2b_update(hash, ctx.ver, sizeof(ctx.ver));
+    ledger_blake2b_update(hash, ctx->ver, sizeof(ctx->ver));
     ledger_blake2b_update(hash, prevs, 32);
     ledger_blake2b_update(hash, seqs, 32);
     ledger_blake2b_update(hash, in->prev, sizeof(in->prev));
-    ledger_blake2b_update(hash, script_len, script_len_size);
+
+    if (script_size > 0) {
+      ledger_blake2b_update(hash, script, script_size);
+      ledger_blake2b_update(hash, in->val, sizeof(in->val));
+      ledger_blake2b_update(hash, in->seq, sizeof(in->seq));
+    } else {
+      ledger_blake2b_update(hash, script_len, script_len_size);
+    }
   }
 
   /**
@@ -1087,13 +1448,15 @@ sign(
     if (*len == 0)
       return 0;
 
-    if (in->script_ctr >= *len) {
+    if (in->script_ctr > *len) {
       ledger_blake2b_update(hash, buf, *len);
       in->script_ctr -= *len;
+      store_script(buf, *len, in->script_ctr);
       return 0;
     }
 
     ledger_blake2b_update(hash, buf, in->script_ctr);
+    store_script(buf, in->script_ctr, 0);
     ledger_blake2b_update(hash, in->val, sizeof(in->val));
     ledger_blake2b_update(hash, in->seq, sizeof(in->seq));
     buf += in->script_ctr;
@@ -1109,7 +1472,7 @@ sign(
    * Afterwards, the signature hash is finalized and signed.
    */
 
-  uint8_t *outs = ctx.outs;
+  uint8_t *outs = ctx->outs;
 
   switch(*type & 0x1f) {
     case SIGHASH_NONE:
@@ -1118,16 +1481,20 @@ sign(
 
     case SIGHASH_SINGLE:
     case SIGHASH_SINGLEREVERSE: {
-      hns_varint_t *output_ctr = &ctx.curr_output_ctr;
+      hns_varint_t *output_ctr = &ctx->curr_output_ctr;
 
-      ledger_apdu_cache_flush(len);
+      /* The output was confirmed and committed to while parsing. */
+      if (ctx->anyonecanpay)
+        break;
+
+      ledger_apdu_cache_flush(LEDGER_APDU_CACHE_TX, len);
 
       if (*output_ctr == 0) {
         if (*len == 0)
           return 0;
 
         if (!read_varint(&buf, len, output_ctr)) {
-          if(!ledger_apdu_cache_write(buf, *len))
+          if(!ledger_apdu_cache_write(LEDGER_APDU_CACHE_TX, buf, *len))
             THROW(HNS_CACHE_WRITE_ERROR);
           return 0;
         }
@@ -1162,29 +1529,38 @@ sign(
   }
 
   ledger_blake2b_update(hash, outs, 32);
-  ledger_blake2b_update(hash, ctx.locktime, sizeof(ctx.locktime));
+  ledger_blake2b_update(hash, ctx->locktime, sizeof(ctx->locktime));
   ledger_blake2b_update(hash, in->type, sizeof(in->type));
   ledger_blake2b_final(hash, digest);
 
-  if(!ledger_ecdsa_sign(in->path, in->depth, digest, 32, sig, 64))
+  uint8_t sig_len = 65;
+  volatile uint8_t *key = NULL;
+
+  if (in->append_key) {
+    key = sig + 65;
+    sig_len += 33;
+  }
+
+  if(!ledger_ecdsa_sign(in->path, in->depth, digest, 32, sig, 64, key))
     THROW(HNS_FAILED_TO_SIGN_INPUT);
 
   sig[64] = *type;
 
-
   /**
    * Confirm the fees iff this is the first SIGHASH_ALL signed input.
    * If we have more SIGHASH_ALL signed inputs, the committed inputs
    * and outputs will be the same.
    */
 
-  if (*type == SIGHASH_ALL && ui->must_confirm) {
+  if (*type == SIGHASH_ALL && ctx->must_confirm) {
     char *hdr = "Fees";
     char *msg = ui->message;
 
-    hex_to_dec(msg, ctx.fees);
+    ui->ctx = (void *)ctx;
+
+    amount_to_dec(msg, ctx->fees);
 
-    if(!ledger_apdu_cache_write(NULL, 65))
+    if(!ledger_apdu_cache_write(LEDGER_APDU_CACHE_TX, NULL, sig_len))
       THROW(HNS_CACHE_WRITE_ERROR);
 
     if (!ledger_ui_update(LEDGER_UI_FEES, hdr, msg, flags))
@@ -1228,7 +1604,7 @@ sign(
         THROW(HNS_UNSUPPORTED_SIGHASH_TYPE);
     }
 
-    if(!ledger_apdu_cache_write(NULL, 65))
+    if(!ledger_apdu_cache_write(LEDGER_APDU_CACHE_TX, NULL, sig_len))
       THROW(HNS_CACHE_WRITE_ERROR);
 
     if (!ledger_ui_update(LEDGER_UI_SIGHASH_TYPE, hdr, msg, flags))
@@ -1237,7 +1613,294 @@ sign(
     return 0;
   }
 
-  return 65;
+  return sig_len;
+}
+
+/**
+ * Presigns a batch of ANYONECANPAY transactions for a Dutch auction.
+ * Every transaction spends the same input and pays the template
+ * output, confirmed in ANYONECANPAY mode, at a price stepped linearly
+ * from the template's value down to the end price.
+ *
+ * The initial message contains the signing key's HD path, the sighash
+ * type, the end price, the number of prices, and the input details.
+ * The whole script must fit in this message. The schedule requires
+ * on-device confirmation. Following messages return the signatures
+ * in schedule order, several signatures per message.
+ *
+ * In:
+ * @param p1 is the first apdu command parameter.
+ * @param len is length of input buffer.
+ * @param buf is the input buffer.
+ *
+ * Out:
+ * @param sig is the output buffer.
+ * @param flags holds the apdu exchange buffer flags.
+ * @return the length of the APDU response.
+ */
+static inline uint8_t
+auction(
+  uint8_t p1,
+  uint16_t *len,
+  volatile uint8_t *buf,
+  volatile uint8_t *sig,
+  volatile uint8_t *flags
+) {
+  hns_auction_t *a = &ctx->auction;
+  hns_input_t *in = &ctx->curr_input;
+  ledger_blake2b_ctx *prefix = blake1;
+  ledger_blake2b_ctx *hash = blake2;
+
+  if (!ctx->tx_parsed || !ctx->anyonecanpay)
+    THROW(HNS_INCORRECT_PARSER_STATE);
+
+  /* The confirmed output must not have a covenant. */
+  if (a->addr.hash_len == 0)
+    THROW(HNS_INCORRECT_PARSER_STATE);
+
+  /**
+   * Parse the schedule and input details. The part of the signature
+   * hash shared by every price is saved in the prefix context.
+   */
+
+  if (p1 & P1_INIT_MASK) {
+    ledger_apdu_cache_clear(LEDGER_APDU_CACHE_TX);
+
+    a->confirmed = false;
+    a->ctr = 0;
+
+    uint8_t path_info = 0;
+
+    if (!read_bip44_path(&buf, len, &in->depth, in->path, &path_info))
+      THROW(HNS_CANNOT_READ_BIP44_PATH);
+
+    if (path_info & HNS_BIP44_NON_ADDR)
+      THROW(HNS_INCORRECT_SIGNATURE_PATH);
+
+    if (!read_bytes(&buf, len, in->type, sizeof(in->type)))
+      THROW(HNS_CANNOT_READ_SIGHASH_TYPE);
+
+    check_anyonecanpay(in->type[0]);
+
+    if (!read_u64(&buf, len, &a->end, HNS_LE))
+      THROW(HNS_CANNOT_READ_AUCTION_PRICE);
+
+    /* Prices are stepped without overflow for any valid amount. */
+    if (a->end > a->start || a->start - a->end > UINT64_MAX / 0xff)
+      THROW(HNS_INCORRECT_AUCTION_PRICE);
+
+    if (!read_u8(&buf, len, &a->steps))
+      THROW(HNS_INCORRECT_AUCTION_STEPS);
+
+    if (a->steps < 2)
+      THROW(HNS_INCORRECT_AUCTION_STEPS);
+
+    if (!read_bytes(&buf, len, in->prev, sizeof(in->prev)))
+      THROW(HNS_CANNOT_READ_PREVOUT);
+
+    if (!read_bytes(&buf, len, in->val, sizeof(in->val)))
+      THROW(HNS_CANNOT_READ_INPUT_VALUE);
+
+    if (!read_bytes(&buf, len, in->seq, sizeof(in->seq)))
+      THROW(HNS_CANNOT_READ_SEQUENCE);
+
+    if (!peek_varint(&buf, len, &in->script_ctr))
+      THROW(HNS_CANNOT_PEEK_SCRIPT_LEN);
+
+    uint8_t script_len[5] = {0};
+    uint8_t script_len_size = size_varint(in->script_ctr);
+
+    if (!read_bytes(&buf, len, script_len, script_len_size))
+      THROW(HNS_CANNOT_READ_SCRIPT_LEN);
+
+    if (in->script_ctr != *len)
+      THROW(HNS_INCORRECT_PARSER_STATE);
+
+    ledger_blake2b_init(prefix, 32);
+    ledger_blake2b_update(prefix, ctx->ver, sizeof(ctx->ver));
+    ledger_blake2b_update(prefix, zero_hash, 32);
+    ledger_blake2b_update(prefix, zero_hash, 32);
+    ledger_blake2b_update(prefix, in->prev, sizeof(in->prev));
+    ledger_blake2b_update(prefix, script_len, script_len_size);
+    ledger_blake2b_update(prefix, buf, *len);
+    ledger_blake2b_update(prefix, in->val, sizeof(in->val));
+    ledger_blake2b_update(prefix, in->seq, sizeof(in->seq));
+    in->script_ctr = 0;
+
+    char start[22];
+    char end[22];
+    char *hdr = "Auction";
+    char *msg = ui->message;
+
+    amount_to_dec(start, a->start);
+    amount_to_dec(end, a->end);
+    snprintf(msg, sizeof(ui->message), "%d prices from %s to %s",
+             a->steps, start, end);
+
+    ui->ctx = (void *)ctx;
+
+    if (!ledger_ui_update(LEDGER_UI_AUCTION, hdr, msg, flags))
+      THROW(HNS_CANNOT_UPDATE_UI);
+
+    return 0;
+  }
+
+  /**
+   * Return the next page of signatures. Each signature hash
+   * commits to a single output paying the current price.
+   */
+
+  if (!a->confirmed)
+    THROW(HNS_SECURITY_CONDITION_NOT_SATISFIED);
+
+  if (*len != 0)
+    THROW(HNS_INCORRECT_LC);
+
+  uint8_t sigs = 0;
+
+  while (a->ctr < a->steps && sigs < HNS_AUCTION_PAGE_SIZE) {
+    uint64_t step = (a->start - a->end) * a->ctr / (a->steps - 1);
+    uint8_t output[8 + 2 + sizeof(a->addr.hash) + 2];
+    volatile uint8_t *o = output;
+    uint8_t output_len = 0;
+    uint8_t digest[32];
+
+    output_len += write_u64(&o, a->start - step, HNS_LE);
+    output_len += write_u8(&o, a->addr.ver);
+    output_len += write_u8(&o, a->addr.hash_len);
+    output_len += write_bytes(&o, a->addr.hash, a->addr.hash_len);
+    output_len += write_u8(&o, HNS_NONE);
+    output_len += write_u8(&o, 0); /* # of covenant items */
+
+    if (ledger_blake2b(output, output_len, digest, 32))
+      THROW(HNS_CANNOT_INIT_BLAKE2B_CTX);
+
+    memmove(hash, prefix, sizeof(ledger_blake2b_ctx));
+    ledger_blake2b_update(hash, digest, 32);
+    ledger_blake2b_update(hash, ctx->locktime, sizeof(ctx->locktime));
+    ledger_blake2b_update(hash, in->type, sizeof(in->type));
+    ledger_blake2b_final(hash, digest);
+
+    if (!ledger_ecdsa_sign(in->path, in->depth, digest, 32, sig, 64, NULL))
+      THROW(HNS_FAILED_TO_SIGN_INPUT);
+
+    sig[64] = in->type[0];
+    sig += 65;
+    sigs++;
+    a->ctr++;
+  }
+
+  if (a->ctr == a->steps)
+    a->confirmed = false;
+
+  return sigs * 65;
+}
+
+/**
+ * Exports the parsed transaction details as a session token. The
+ * token is authenticated with a key derived from the device's seed,
+ * so it can be imported in a later session to sign inputs without
+ * re-parsing the transaction or re-confirming its outputs.
+ *
+ * In:
+ * @param p1 is the first apdu command parameter.
+ * @param len is length of input buffer.
+ *
+ * Out:
+ * @param res is the APDU response.
+ * @return the length of the APDU response.
+ */
+static inline uint8_t
+export_tx(uint8_t p1, uint16_t *len, volatile uint8_t *res) {
+  uint8_t state[TOKEN_STATE_SIZE];
+  uint8_t mac[TOKEN_MAC_SIZE];
+  volatile uint8_t *s = state;
+
+  if (!(p1 & P1_INIT_MASK))
+    THROW(HNS_INCORRECT_P1);
+
+  if (*len != 0)
+    THROW(HNS_INCORRECT_LC);
+
+  if (!ctx->outs_approved || ctx->anyonecanpay)
+    THROW(HNS_INCORRECT_PARSER_STATE);
+
+  write_bytes(&s, ctx->ver, sizeof(ctx->ver));
+  write_bytes(&s, ctx->locktime, sizeof(ctx->locktime));
+  write_bytes(&s, ctx->prevs, sizeof(ctx->prevs));
+  write_bytes(&s, ctx->seqs, sizeof(ctx->seqs));
+  write_bytes(&s, ctx->outs, sizeof(ctx->outs));
+  write_u64(&s, ctx->fees, HNS_LE);
+
+  if (!ledger_hmac_sha256(token_path, 2, state, sizeof(state), mac))
+    THROW(HNS_FAILED_TO_AUTH_SESSION_TOKEN);
+
+  *len = write_bytes(&res, state, sizeof(state));
+  *len += write_bytes(&res, mac, sizeof(mac));
+
+  return *len;
+}
+
+/**
+ * Imports a session token created by export_tx. If the token is
+ * authentic, the parser's state is restored and the client may
+ * send signature requests. The fees must be confirmed again.
+ *
+ * In:
+ * @param p1 is the first apdu command parameter.
+ * @param len is length of input buffer.
+ * @param buf is the input buffer.
+ *
+ * Out:
+ * @return the length of the APDU response.
+ */
+static inline uint8_t
+import_tx(uint8_t p1, uint16_t *len, volatile uint8_t *buf) {
+  uint8_t state[TOKEN_STATE_SIZE];
+  uint8_t mac[TOKEN_MAC_SIZE];
+  uint8_t digest[TOKEN_MAC_SIZE];
+  volatile uint8_t *s = state;
+  uint16_t state_len = sizeof(state);
+  uint8_t diff = 0;
+  uint8_t i;
+
+  if (!(p1 & P1_INIT_MASK))
+    THROW(HNS_INCORRECT_P1);
+
+  if (*len != sizeof(state) + sizeof(mac))
+    THROW(HNS_CANNOT_READ_SESSION_TOKEN);
+
+  if (!read_bytes(&buf, len, state, sizeof(state)))
+    THROW(HNS_CANNOT_READ_SESSION_TOKEN);
+
+  if (!read_bytes(&buf, len, mac, sizeof(mac)))
+    THROW(HNS_CANNOT_READ_SESSION_TOKEN);
+
+  if (!ledger_hmac_sha256(token_path, 2, state, sizeof(state), digest))
+    THROW(HNS_FAILED_TO_AUTH_SESSION_TOKEN);
+
+  /* Compare in constant time. */
+  for (i = 0; i < sizeof(mac); i++)
+    diff |= mac[i] ^ digest[i];
+
+  if (diff != 0)
+    THROW(HNS_SESSION_TOKEN_MISMATCH);
+
+  ledger_apdu_cache_clear(LEDGER_APDU_CACHE_TX);
+
+  memset(ctx, 0, sizeof(hns_tx_t));
+  g_hns_sign.owner = HNS_SIGN_OWNER_TX;
+  read_bytes(&s, &state_len, ctx->ver, sizeof(ctx->ver));
+  read_bytes(&s, &state_len, ctx->locktime, sizeof(ctx->locktime));
+  read_bytes(&s, &state_len, ctx->prevs, sizeof(ctx->prevs));
+  read_bytes(&s, &state_len, ctx->seqs, sizeof(ctx->seqs));
+  read_bytes(&s, &state_len, ctx->outs, sizeof(ctx->outs));
+  read_u64(&s, &state_len, &ctx->fees, HNS_LE);
+  ctx->tx_parsed = true;
+  ctx->outs_approved = true;
+  ctx->must_confirm = true;
+
+  return 0;
 }
 
 uint16_t
@@ -1254,10 +1917,8 @@ hns_apdu_get_input_signature(
       if (!ledger_unlocked())
         THROW(HNS_SECURITY_CONDITION_NOT_SATISFIED);
 
-      if (p2 == PARSE) {
+      if (p2 == PARSE || p2 == IMPORT)
         ui = ledger_ui_init_session();
-        ui->must_confirm = true;
-      }
       break;
 
     case NO:
@@ -1268,6 +1929,16 @@ hns_apdu_get_input_signature(
       break;
   };
 
+  /**
+   * Message signing shares memory with the transaction. Unless
+   * a new transaction is being parsed or imported, the signing
+   * state must still hold the transaction.
+   */
+
+  if (g_hns_sign.owner != HNS_SIGN_OWNER_TX)
+    if (!(p1 & P1_INIT_MASK) || (p2 != PARSE && p2 != IMPORT))
+      THROW(HNS_INCORRECT_PARSER_STATE);
+
   switch(p2) {
     case PARSE:
       len = parse(p1, &len, in, out, flags);
@@ -1277,6 +1948,18 @@ hns_apdu_get_input_signature(
       len = sign(p1, &len, in, out, flags);
       break;
 
+    case EXPORT:
+      len = export_tx(p1, &len, out);
+      break;
+
+    case AUCTION:
+      len = auction(p1, &len, in, out, flags);
+      break;
+
+    case IMPORT:
+      len = import_tx(p1, &len, in);
+      break;
+
     default:
       THROW(HNS_INCORRECT_P2);
       break;
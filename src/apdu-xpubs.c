@@ -0,0 +1,114 @@
+/**
+ * apdu-xpubs.c - batch account xpub derivation for hns
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#include "apdu.h"
+#include "ledger.h"
+#include "utils.h"
+
+/**
+ * Fingerprint of the last derived coin type node. Accounts of the
+ * same coin type share it, so it is derived once per coin type
+ * rather than once per account, including across messages.
+ */
+static struct {
+  uint32_t coin; /* hardened, so zero means empty */
+  uint8_t fp[4];
+} parent;
+
+uint16_t
+hns_apdu_get_account_xpubs(
+  uint8_t p1,
+  uint8_t p2,
+  uint16_t len,
+  volatile uint8_t *buf,
+  volatile uint8_t *out,
+  volatile uint8_t *flags
+) {
+  if (!ledger_unlocked())
+    THROW(HNS_SECURITY_CONDITION_NOT_SATISFIED);
+
+  if (p1 != 0)
+    THROW(HNS_INCORRECT_P1);
+
+  if (p2 != 0)
+    THROW(HNS_INCORRECT_P2);
+
+  uint32_t coin;
+  uint32_t account;
+  uint8_t coins;
+  uint8_t accounts;
+  uint8_t index;
+
+  if (!read_u32(&buf, &len, &coin, HNS_BE))
+    THROW(HNS_CANNOT_READ_ACCOUNT_RANGE);
+
+  if (!read_u8(&buf, &len, &coins))
+    THROW(HNS_CANNOT_READ_ACCOUNT_RANGE);
+
+  if (!read_u32(&buf, &len, &account, HNS_BE))
+    THROW(HNS_CANNOT_READ_ACCOUNT_RANGE);
+
+  if (!read_u8(&buf, &len, &accounts))
+    THROW(HNS_CANNOT_READ_ACCOUNT_RANGE);
+
+  if (!read_u8(&buf, &len, &index))
+    THROW(HNS_CANNOT_READ_ACCOUNT_RANGE);
+
+  if (len != 0)
+    THROW(HNS_INCORRECT_LC);
+
+  if (coin < HNS_BIP44_MAINNET || coin > HNS_BIP44_SIMNET)
+    THROW(HNS_INCORRECT_ACCOUNT_RANGE);
+
+  if (coins < 1 || (uint32_t)coins - 1 > HNS_BIP44_SIMNET - coin)
+    THROW(HNS_INCORRECT_ACCOUNT_RANGE);
+
+  if (!(account & HNS_HARDENED))
+    THROW(HNS_INCORRECT_ACCOUNT_RANGE);
+
+  if (accounts < 1 || (uint32_t)accounts - 1 > 0xffffffff - account)
+    THROW(HNS_INCORRECT_ACCOUNT_RANGE);
+
+  /**
+   * Xpubs are ordered by coin type, then account.
+   * The index is the first xpub returned.
+   */
+
+  uint16_t total = coins * accounts;
+
+  if (total > 0xff || index >= total)
+    THROW(HNS_INCORRECT_ACCOUNT_RANGE);
+
+  uint8_t xpubs = total - index;
+
+  if (xpubs > HNS_XPUB_PAGE_SIZE)
+    xpubs = HNS_XPUB_PAGE_SIZE;
+
+  ledger_ecdsa_xpub_t xpub;
+
+  xpub.depth = HNS_BIP44_ACCT_DEPTH;
+  xpub.path[0] = HNS_BIP44_PURPOSE;
+
+  len = write_u8(&out, xpubs);
+
+  while (xpubs--) {
+    xpub.path[1] = coin + index / accounts;
+    xpub.path[2] = account + index % accounts;
+    index++;
+
+    if (parent.coin != xpub.path[1]) {
+      ledger_ecdsa_derive_fingerprint(xpub.path, 2, parent.fp);
+      parent.coin = xpub.path[1];
+    }
+
+    ledger_ecdsa_derive_child(&xpub);
+
+    len += write_bytes(&out, xpub.key, sizeof(xpub.key));
+    len += write_bytes(&out, xpub.code, sizeof(xpub.code));
+    len += write_bytes(&out, parent.fp, sizeof(parent.fp));
+  }
+
+  return len;
+}
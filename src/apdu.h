@@ -7,6 +7,7 @@
 #define _HNS_APDU_H
 
 #include <stdint.h>
+#include "resource.h"
 #include "utils.h"
 
 /**
@@ -76,6 +77,44 @@
 #define HNS_CANNOT_CREATE_COVENANT_NAME_HASH 0x36
 #define HNS_COVENANT_NAME_HASH_MISMATCH 0x37
 #define HNS_CHANGE_ADDRESS_MISMATCH 0x38
+#define HNS_CANNOT_READ_CHANGE_OUTPUTS_LEN 0x39
+#define HNS_INCORRECT_CHANGE_OUTPUTS_LEN 0x3a
+#define HNS_INCORRECT_CHANGE_OUTPUT_INDEX 0x3b
+#define HNS_CANNOT_READ_SESSION_TOKEN 0x3c
+#define HNS_SESSION_TOKEN_MISMATCH 0x3d
+#define HNS_CANNOT_READ_AUCTION_PRICE 0x3e
+#define HNS_INCORRECT_AUCTION_PRICE 0x3f
+#define HNS_INCORRECT_AUCTION_STEPS 0x40
+#define HNS_INCORRECT_PREVOUT_REF 0x41
+#define HNS_CANNOT_READ_SCRIPT_SELECTOR 0x42
+#define HNS_INCORRECT_SCRIPT_SELECTOR 0x43
+#define HNS_SCRIPT_POOL_FULL 0x44
+#define HNS_INCORRECT_RESOURCE_LEN 0x45
+#define HNS_INCORRECT_RESOURCE 0x46
+#define HNS_INPUT_VALUE_OVERFLOW 0x47
+#define HNS_OUTPUT_VALUE_OVERFLOW 0x48
+#define HNS_CANNOT_READ_ACCOUNT_RANGE 0x49
+#define HNS_INCORRECT_ACCOUNT_RANGE 0x4a
+#define HNS_CANNOT_READ_MESSAGE_LEN 0x4b
+#define HNS_INCORRECT_MESSAGE_LEN 0x4c
+#define HNS_FAILED_TO_SIGN_MESSAGE 0x4d
+#define HNS_FAILED_TO_AUTH_SESSION_TOKEN 0x4e
+
+/**
+ * Optional protocol features, advertised by GET CAPABILITIES.
+ */
+#define HNS_FEATURE_CHANGE_OUTPUTS 0x00000001 /* multiple change outputs */
+#define HNS_FEATURE_ANYONECANPAY 0x00000002   /* ANYONECANPAY parse mode */
+#define HNS_FEATURE_COMPACT_NAMES 0x00000004
+#define HNS_FEATURE_COMPACT_PREVS 0x00000008
+#define HNS_FEATURE_SCRIPT_POOL 0x00000010    /* script selector and pool */
+#define HNS_FEATURE_APPEND_PUBKEY 0x00000020
+#define HNS_FEATURE_EXPORT_IMPORT 0x00000040
+#define HNS_FEATURE_AUCTION 0x00000080        /* presigned auctions */
+#define HNS_FEATURE_PARSE_TXID 0x00000100     /* txid returned by parse */
+#define HNS_FEATURE_RESOURCES 0x00000200      /* resources are validated */
+#define HNS_FEATURE_ACCOUNT_XPUBS 0x00000400  /* GET ACCOUNT XPUBS */
+#define HNS_FEATURE_SIGN_MESSAGE 0x00000800   /* SIGN MESSAGE */
 
 /**
  * These constants are used to determine the covenant type.
@@ -97,6 +136,20 @@
  * Covenant items for respective covenant types.
  */
 
+/**
+ * Maximum number of items parsed per covenant,
+ * including names that are not covenant items.
+ */
+#define HNS_MAX_COV_ITEMS 7
+
+typedef struct hns_claim_s {
+  uint8_t name_hash[32];
+  uint8_t height[4];
+  uint8_t flags;
+  uint8_t commit_hash[32];
+  uint8_t commit_height[4];
+} hns_claim_t;
+
 typedef struct hns_open_s {
   uint8_t name_hash[32];
   uint8_t height[4];
@@ -119,22 +172,15 @@ typedef struct hns_redeem_s {
   uint8_t height[4];
 } hns_redeem_t;
 
-/**
- * TODO(boymanjor): optimize memory
- * usage to handle 512-byte resources
- * in register and update covenants.
- */
 typedef struct hns_register_s {
   uint8_t name_hash[32];
   uint8_t height[4];
-  hns_varint_t resource_ctr;
   uint8_t hash[32];
 } hns_register_t;
 
 typedef struct hns_update_s {
   uint8_t name_hash[32];
   uint8_t height[4];
-  hns_varint_t resource_ctr;
 } hns_update_t;
 
 typedef struct hns_renew_s {
@@ -147,7 +193,7 @@ typedef struct hns_transfer_s {
   uint8_t name_hash[32];
   uint8_t height[4];
   uint8_t addr_ver;
-  uint8_t addr_len;
+  uint8_t addr_len; /* must precede addr_hash */
   uint8_t addr_hash[32];
 } hns_transfer_t;
 
@@ -166,6 +212,7 @@ typedef struct hns_revoke_s {
 } hns_revoke_t;
 
 typedef union {
+  hns_claim_t claim;
   hns_open_t open;
   hns_bid_t bid;
   hns_reveal_t reveal;
@@ -185,6 +232,8 @@ typedef union {
 typedef struct hns_cov_s {
   uint8_t type;
   hns_varint_t items_len;
+  hns_varint_t resource_ctr; /* resource bytes left to parse */
+  hns_resource_t resource; /* summary of the decoded resource */
   hns_cov_items_t items;
 
   /* Name is stored on covenant to allow
@@ -203,6 +252,23 @@ typedef struct hns_addr_s {
   uint8_t hash[32];
 } hns_addr_t;
 
+/**
+ * Maximum number of change outputs verified on-device.
+ */
+#define HNS_MAX_CHANGE_OUTPUTS 4
+
+/**
+ * Change output struct. Only P2PKH change
+ * addresses are verified, so the hash is
+ * always 20 bytes.
+ */
+
+typedef struct hns_change_s {
+  uint8_t index;
+  uint8_t ver;
+  uint8_t hash[20];
+} hns_change_t;
+
 /**
  * Input struct.
  */
@@ -215,6 +281,7 @@ typedef struct hns_input_s {
   uint8_t depth;
   uint32_t path[HNS_MAX_DEPTH];
   hns_varint_t script_ctr;
+  bool append_key; /* return the pubkey with the signature */
 } hns_input_t;
 
 /**
@@ -222,11 +289,64 @@ typedef struct hns_input_s {
  */
 
 typedef struct hns_output_s {
-  uint8_t val[8];
+  hns_amount_t val;
   hns_addr_t addr;
   hns_cov_t cov;
 } hns_output_t;
 
+/**
+ * Maximum number of xpubs returned per
+ * message when deriving account xpubs.
+ */
+#define HNS_XPUB_PAGE_SIZE 3
+
+/**
+ * Maximum number of signatures returned
+ * per message when presigning an auction.
+ */
+#define HNS_AUCTION_PAGE_SIZE 3
+
+/**
+ * Size of the pool holding the redeem scripts stored
+ * for the session, and the max number of stored scripts.
+ */
+#define HNS_SCRIPT_POOL_SIZE 192
+#define HNS_MAX_SCRIPTS 4
+
+/**
+ * Redeem scripts stored for the session. Each script is
+ * serialized with its varint length. Script i occupies
+ * data[offset[i]] up to data[offset[i + 1]].
+ */
+typedef struct hns_script_pool_s {
+  bool storing; /* a script is being written */
+  uint8_t len; /* # of stored scripts */
+  uint8_t size; /* bytes used */
+  uint8_t offset[HNS_MAX_SCRIPTS + 1];
+  uint8_t data[HNS_SCRIPT_POOL_SIZE];
+} hns_script_pool_t;
+
+/**
+ * Number of recently sent prevout txids that
+ * can be referenced by compact prevouts.
+ */
+#define HNS_TXID_TABLE_SIZE 4
+
+/**
+ * Auction struct. The template is the output
+ * confirmed in ANYONECANPAY mode. Its value
+ * is the auction's start price.
+ */
+
+typedef struct hns_auction_s {
+  bool confirmed;
+  uint8_t steps;
+  uint8_t ctr;
+  hns_amount_t start;
+  hns_amount_t end;
+  hns_addr_t addr;
+} hns_auction_t;
+
 /**
  * Struct used to handle tx
  * parsing and signing state.
@@ -234,6 +354,12 @@ typedef struct hns_output_s {
 
 typedef struct hns_tx_s {
   bool tx_parsed;
+  bool outs_approved; /* every output approved on-screen */
+  bool anyonecanpay; /* single output, no inputs parsed */
+  bool compact_names; /* names sent in place of name hashes */
+  bool compact_prevs; /* prevout txids may reference txid table */
+  bool must_confirm; /* fees not yet confirmed on-screen */
+  uint8_t confirm_ctr; /* outputs confirmed on-screen */
   uint8_t next_field;
   uint8_t next_item;
   uint8_t ins_len;
@@ -247,14 +373,77 @@ typedef struct hns_tx_s {
   uint8_t txid[32];
   uint8_t locktime[4];
   uint8_t change_flag;
-  uint8_t change_index;
-  uint8_t fees[8];
-  hns_addr_t change;
+  uint8_t change_len;
+  uint8_t change_ctr;
+  hns_amount_t fees; /* inputs less outputs, unless ANYONECANPAY */
+  uint8_t txids[HNS_TXID_TABLE_SIZE][32];
+  uint8_t txids_next; /* table entry replaced by the next literal txid */
+  uint8_t txids_len; /* table entries filled, at most HNS_TXID_TABLE_SIZE */
+  hns_change_t change[HNS_MAX_CHANGE_OUTPUTS];
   hns_input_t curr_input;
   hns_output_t curr_output;
   hns_varint_t curr_output_ctr; /* for single output commitments */
+  hns_auction_t auction;
+  hns_script_pool_t scripts;
+  ledger_blake2b_ctx txid_hash; /* only used while parsing */
 } hns_tx_t;
 
+/**
+ * Number of message characters previewed on-screen.
+ */
+#define HNS_MSG_PREVIEW_LEN 32
+
+/**
+ * Message signing struct.
+ */
+
+typedef struct hns_msg_s {
+  bool streaming; /* message chunks are expected */
+  uint8_t depth;
+  uint32_t path[HNS_BIP44_ADDR_DEPTH];
+  uint32_t len;
+  uint32_t left; /* message bytes not yet received */
+  uint8_t preview_len;
+  char preview[HNS_MSG_PREVIEW_LEN + 4]; /* ellipsis and null */
+  uint8_t digest[32];
+} hns_msg_t;
+
+/**
+ * These constants indicate which instruction holds the signing state.
+ */
+
+#define HNS_SIGN_OWNER_NONE 0x00
+#define HNS_SIGN_OWNER_TX 0x01
+#define HNS_SIGN_OWNER_MSG 0x02
+
+/**
+ * Signing state struct.
+ *
+ * Transactions and messages are never signed at the same time,
+ * so their state shares memory. Starting either one discards
+ * the other, and the owner records which one is held.
+ */
+
+typedef struct hns_sign_ctx_s {
+  uint8_t owner;
+  union {
+    struct {
+      hns_tx_t tx;
+      ledger_blake2b_ctx tx_hash1;
+      ledger_blake2b_ctx tx_hash2;
+    };
+    struct {
+      hns_msg_t msg;
+      ledger_blake2b_ctx msg_hash;
+    };
+  };
+} hns_sign_ctx_t;
+
+/**
+ * Global signing context.
+ */
+extern hns_sign_ctx_t g_hns_sign;
+
 /**
  * Returns the application's version number.
  *
@@ -280,6 +469,32 @@ hns_apdu_get_app_version(
   volatile uint8_t *flags
 );
 
+/**
+ * Returns the optional protocol features and limits
+ * supported by the application.
+ *
+ * In:
+ * @param p1 is first instruction param
+ * @param p2 is second instruction param
+ * @param len is length of the command data buffer
+ *
+ * Out:
+ * @param in is the command data buffer
+ * @param out is the output buffer
+ * @param flags is bit array for apdu exchange flags
+ * @return the status word
+ */
+
+uint8_t
+hns_apdu_get_capabilities(
+  uint8_t p1,
+  uint8_t p2,
+  uint8_t len,
+  volatile uint8_t *in,
+  volatile uint8_t *out,
+  volatile uint8_t *flags
+);
+
 /**
  * Derives a public key, extended public key, and/or bech32 address.
  *
@@ -305,6 +520,56 @@ hns_apdu_get_public_key(
   volatile uint8_t *flags
 );
 
+/**
+ * Derives the extended public keys of a range of accounts.
+ *
+ * In:
+ * @param p1 is first instruction param
+ * @param p2 is second instruction param
+ * @param len is length of the command data buffer
+ *
+ * Out:
+ * @param in is the command data buffer
+ * @param out is the output buffer
+ * @param flags is bit array for apdu exchange flags
+ * @return the status word
+ */
+
+uint16_t
+hns_apdu_get_account_xpubs(
+  uint8_t p1,
+  uint8_t p2,
+  uint16_t len,
+  volatile uint8_t *in,
+  volatile uint8_t *out,
+  volatile uint8_t *flags
+);
+
+/**
+ * Signs a message streamed over one or more messages.
+ *
+ * In:
+ * @param p1 is first instruction param
+ * @param p2 is second instruction param
+ * @param len is length of the command data buffer
+ *
+ * Out:
+ * @param in is the command data buffer
+ * @param out is the output buffer
+ * @param flags is bit array for apdu exchange flags
+ * @return the status word
+ */
+
+uint16_t
+hns_apdu_sign_message(
+  uint8_t p1,
+  uint8_t p2,
+  uint16_t len,
+  volatile uint8_t *in,
+  volatile uint8_t *out,
+  volatile uint8_t *flags
+);
+
 /**
  * Parses transaction details and signs transaction inputs.
  *
@@ -6,18 +6,69 @@
 #include "apdu.h"
 #include "glyphs.h"
 #include "ledger.h"
-#include "segwit-addr.h"
 #include "utils.h"
 
-/* Save 48 bytes here by not using a pointer array. */
-static const char network_prefix[4][3] = {"hs", "ts", "rs", "ss"};
-
 static const char covenant_labels[12][9] = {
   "NONE", "CLAIM", "OPEN", "BID",
   "REVEAL", "REDEEM", "REGISTER", "UPDATE",
   "RENEW", "TRANSFER", "FINALIZE", "REVOKE"
 };
 
+/**
+ * Sends the response cached by the instruction that requested
+ * on-screen approval. Public key requests have their own apdu
+ * cache, and the signing instructions share the tx cache.
+ * Approving the fees clears the transaction's pending fee
+ * confirmation, so that later inputs are signed without it.
+ * Approving an auction allows its signatures to be returned.
+ */
+static void
+ledger_ui_approve_send(void) {
+  enum ledger_apdu_cache cache = LEDGER_APDU_CACHE_TX;
+
+  if (g_ledger.ui.state == LEDGER_UI_KEY)
+    cache = LEDGER_APDU_CACHE_KEY;
+
+  if (g_ledger.ui.state == LEDGER_UI_FEES)
+    ((hns_tx_t *)g_ledger.ui.ctx)->must_confirm = false;
+
+  if (g_ledger.ui.state == LEDGER_UI_AUCTION)
+    ((hns_tx_t *)g_ledger.ui.ctx)->auction.confirmed = true;
+
+  uint8_t len = ledger_apdu_cache_flush(cache, NULL);
+  ledger_apdu_exchange(IO_RETURN_AFTER_TX, len, HNS_OK);
+  ledger_ui_idle();
+}
+
+/**
+ * Sends the rejection of an on-screen confirmation. Rejecting
+ * an output, the fees, or an auction clears the transaction, so
+ * it can be neither exported nor signed without being re-parsed.
+ */
+static void
+ledger_ui_reject_send(void) {
+  switch (g_ledger.ui.state) {
+    case LEDGER_UI_OUTPUT:
+    case LEDGER_UI_VALUE:
+    case LEDGER_UI_ADDRESS:
+    case LEDGER_UI_NEW_OWNER:
+    case LEDGER_UI_COVENANT_TYPE:
+    case LEDGER_UI_NAME:
+    case LEDGER_UI_RESOURCE:
+    case LEDGER_UI_FEES:
+    case LEDGER_UI_AUCTION:
+      memset(g_ledger.ui.ctx, 0, sizeof(hns_tx_t));
+      break;
+
+    default:
+      break;
+  }
+
+  ledger_apdu_buffer_clear();
+  ledger_apdu_exchange(IO_RETURN_AFTER_TX, 0, HNS_CONDITIONS_OF_USE_NOT_SATISFIED);
+  ledger_ui_idle();
+}
+
 #if !defined(HAVE_UX_FLOW)
 
 /**
@@ -120,9 +171,7 @@ static uint32_t
 ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
   switch (mask) {
     case BUTTON_EVT_RELEASED | BUTTON_LEFT: {
-      ledger_apdu_buffer_clear();
-      ledger_apdu_exchange(IO_RETURN_AFTER_TX, 0, HNS_CONDITIONS_OF_USE_NOT_SATISFIED);
-      ledger_ui_idle();
+      ledger_ui_reject_send();
       break;
     }
 
@@ -130,11 +179,24 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
       switch(g_ledger.ui.state) {
         case LEDGER_UI_KEY:
         case LEDGER_UI_FEES:
-        case LEDGER_UI_SIGHASH_TYPE: {
-          uint8_t len = ledger_apdu_cache_flush(NULL);
-          ledger_apdu_exchange(IO_RETURN_AFTER_TX, len, HNS_OK);
-          g_ledger.ui.must_confirm = false;
-          ledger_ui_idle();
+        case LEDGER_UI_SIGHASH_TYPE:
+        case LEDGER_UI_AUCTION:
+        case LEDGER_UI_DIGEST: {
+          ledger_ui_approve_send();
+          break;
+        }
+
+        case LEDGER_UI_MESSAGE: {
+          hns_msg_t *msg = (hns_msg_t *)g_ledger.ui.ctx;
+          char *hdr = "Digest";
+          char *txt = g_ledger.ui.message;
+          volatile uint8_t *flags = g_ledger.ui.flags;
+
+          bin_to_hex(txt, msg->digest, sizeof(msg->digest));
+
+          if (!ledger_ui_update(LEDGER_UI_DIGEST, hdr, txt, flags))
+            THROW(HNS_CANNOT_UPDATE_UI);
+
           break;
         }
 
@@ -142,13 +204,12 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
           hns_tx_t *ctx = (hns_tx_t *)g_ledger.ui.ctx;
           hns_output_t *out = &ctx->curr_output;
           char *hdr = "Covenant Type";
-          char *msg = g_ledger.ui.message;
           volatile uint8_t *flags = g_ledger.ui.flags;
 
           if (out->cov.type < HNS_NONE || out->cov.type > HNS_REVOKE)
             THROW(HNS_UNSUPPORTED_COVENANT_TYPE);
 
-          strcpy(msg, covenant_labels[out->cov.type]);
+          char *msg = (char *)covenant_labels[out->cov.type];
           ledger_ui_update(LEDGER_UI_COVENANT_TYPE, hdr, msg, flags);
           break;
         }
@@ -162,7 +223,7 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
             char *msg = g_ledger.ui.message;
             volatile uint8_t *flags = g_ledger.ui.flags;
 
-            hex_to_dec(msg, out->val);
+            amount_to_dec(msg, out->val);
 
             if (!ledger_ui_update(LEDGER_UI_VALUE, hdr, msg, flags))
               THROW(HNS_CANNOT_UPDATE_UI);
@@ -171,11 +232,9 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
           }
 
           char *hdr = "Name";
-          char *msg = g_ledger.ui.message;
+          char *msg = out->cov.name;
           volatile uint8_t *flags = g_ledger.ui.flags;
 
-          strcpy(msg, out->cov.name);
-
           if(!ledger_ui_update(LEDGER_UI_NAME, hdr, msg, flags))
             THROW(HNS_CANNOT_UPDATE_UI);
 
@@ -186,23 +245,31 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
           hns_tx_t *ctx = (hns_tx_t *)g_ledger.ui.ctx;
           hns_output_t *out = &ctx->curr_output;
 
+          if (out->cov.type == HNS_REGISTER || out->cov.type == HNS_UPDATE) {
+            char *hdr = "Resource";
+            char *msg = g_ledger.ui.message;
+            volatile uint8_t *flags = g_ledger.ui.flags;
+
+            hns_resource_summary(&out->cov.resource, msg,
+                                 sizeof(g_ledger.ui.message));
+
+            if (!ledger_ui_update(LEDGER_UI_RESOURCE, hdr, msg, flags))
+              THROW(HNS_CANNOT_UPDATE_UI);
+
+            break;
+          }
+
           if (out->cov.type == HNS_TRANSFER) {
-            char hrp[3];
             char *hdr = "New Owner";
             char *msg = g_ledger.ui.message;
             volatile uint8_t *flags = g_ledger.ui.flags;
-            uint8_t netflag = g_ledger.ui.network >> 1;
+            uint8_t network = g_ledger.ui.network >> 1;
             hns_transfer_t *t = &out->cov.items.transfer;
             uint8_t ver = t->addr_ver;
             uint8_t *hash = t->addr_hash;
             uint8_t len = t->addr_len;
 
-            if (netflag < 0 || netflag > 3)
-              THROW(HNS_INCORRECT_P1);
-
-            strcpy(hrp, network_prefix[netflag]);
-
-            if (!segwit_addr_encode(msg, hrp, ver, hash, len))
+            if (!encode_segwit_addr(msg, network, ver, hash, len))
               THROW(HNS_CANNOT_ENCODE_ADDRESS);
 
             if (!ledger_ui_update(LEDGER_UI_NEW_OWNER, hdr, msg, flags))
@@ -215,7 +282,7 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
           char *msg = g_ledger.ui.message;
           volatile uint8_t *flags = g_ledger.ui.flags;
 
-          hex_to_dec(msg, out->val);
+          amount_to_dec(msg, out->val);
 
           if (!ledger_ui_update(LEDGER_UI_VALUE, hdr, msg, flags))
             THROW(HNS_CANNOT_UPDATE_UI);
@@ -223,6 +290,7 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
           break;
         }
 
+        case LEDGER_UI_RESOURCE:
         case LEDGER_UI_NEW_OWNER: {
           hns_tx_t *ctx = (hns_tx_t *)g_ledger.ui.ctx;
           hns_output_t *out = &ctx->curr_output;
@@ -230,7 +298,7 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
           char *msg = g_ledger.ui.message;
           volatile uint8_t *flags = g_ledger.ui.flags;
 
-          hex_to_dec(msg, out->val);
+          amount_to_dec(msg, out->val);
 
           if (!ledger_ui_update(LEDGER_UI_VALUE, hdr, msg, flags))
             THROW(HNS_CANNOT_UPDATE_UI);
@@ -241,18 +309,12 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
         case LEDGER_UI_VALUE: {
           hns_tx_t *ctx = (hns_tx_t *)g_ledger.ui.ctx;
           hns_addr_t *a = &ctx->curr_output.addr;
-          char hrp[3];
           char *hdr = "Address";
           char *msg = g_ledger.ui.message;
           volatile uint8_t *flags = g_ledger.ui.flags;
-          uint8_t netflag = g_ledger.ui.network >> 1;
-
-          if (netflag < 0 || netflag > 3)
-            THROW(HNS_INCORRECT_P1);
+          uint8_t network = g_ledger.ui.network >> 1;
 
-          strcpy(hrp, network_prefix[netflag]);
-
-          if (!segwit_addr_encode(msg, hrp, a->ver, a->hash, a->hash_len))
+          if (!encode_segwit_addr(msg, network, a->ver, a->hash, a->hash_len))
             THROW(HNS_CANNOT_ENCODE_ADDRESS);
 
           ledger_ui_update(LEDGER_UI_ADDRESS, hdr, msg, flags);
@@ -260,8 +322,9 @@ ledger_ui_approve_button(uint32_t mask, uint32_t ctr) {
         }
 
         case LEDGER_UI_ADDRESS: {
-          hns_output_t *out = &((hns_tx_t *)g_ledger.ui.ctx)->curr_output;
-          memset(out, 0, sizeof(hns_output_t));
+          hns_tx_t *tx = (hns_tx_t *)g_ledger.ui.ctx;
+          memset(&tx->curr_output, 0, sizeof(hns_output_t));
+          tx->outs_approved = tx->tx_parsed;
           ledger_apdu_exchange(IO_RETURN_AFTER_TX, g_ledger.ui.buflen, HNS_OK);
           ledger_ui_idle();
           break;
@@ -380,7 +443,10 @@ ledger_ui_update(
     return false;
 
   memmove(g_ledger.ui.header, header, header_len + 1);
-  memmove(g_ledger.ui.message, message, message_len + 1);
+
+  /* Messages are often formatted in place. */
+  if (message != g_ledger.ui.message)
+    memmove(g_ledger.ui.message, message, message_len + 1);
   memmove(g_ledger.ui.viewport, g_ledger.ui.message, 12);
   g_ledger.ui.viewport[12] = '\0';
   g_ledger.ui.message_len = message_len;
@@ -388,6 +454,7 @@ ledger_ui_update(
   g_ledger.ui.state = state;
   *flags |= IO_ASYNCH_REPLY;
   UX_DISPLAY(ledger_ui_display, ledger_ui_display_prepro);
+  ledger_ui_headless_show();
 
   return true;
 }
@@ -424,8 +491,9 @@ UX_FLOW(ledger_ui_main,
  */
 static unsigned int
 ledger_ui_output_accept_fn(void) {
-  hns_output_t *out = &((hns_tx_t *)g_ledger.ui.ctx)->curr_output;
-  memset(out, 0, sizeof(hns_output_t));
+  hns_tx_t *tx = (hns_tx_t *)g_ledger.ui.ctx;
+  memset(&tx->curr_output, 0, sizeof(hns_output_t));
+  tx->outs_approved = tx->tx_parsed;
   ledger_apdu_exchange(IO_RETURN_AFTER_TX, g_ledger.ui.buflen, HNS_OK);
   ledger_ui_idle();
   return 0;
@@ -433,41 +501,123 @@ ledger_ui_output_accept_fn(void) {
 
 static unsigned int
 ledger_ui_output_reject_fn(void) {
-  ledger_apdu_buffer_clear();
-  ledger_apdu_exchange(IO_RETURN_AFTER_TX, 0, HNS_CONDITIONS_OF_USE_NOT_SATISFIED);
-  ledger_ui_idle();
+  ledger_ui_reject_send();
   return 0;
 }
 
-UX_STEP_NOCB(ledger_ui_output_init, pnn, {
+/**
+ * Renders a field of the output under review into the message
+ * buffer. Each review step renders its field right before it is
+ * displayed, so only the field on-screen is held in RAM, and
+ * rejecting an output early skips the remaining encodings. The
+ * last rendered field is memoized, so redisplaying a step does
+ * not format it again.
+ */
+static void
+ledger_ui_render(enum ledger_ui_state field) {
+  ledger_ui_ctx_t *ui = &g_ledger.ui;
+  hns_tx_t *ctx = (hns_tx_t *)ui->ctx;
+  hns_output_t *out = &ctx->curr_output;
+  uint8_t network = ui->network >> 1;
+  char *msg = ui->message;
+
+  if (ui->memo_output == ctx->confirm_ctr && ui->memo_field == field)
+    return;
+
+  /* The message is about to be overwritten. */
+  ui->memo_output = 0;
+
+  switch(field) {
+    case LEDGER_UI_OUTPUT:
+      snprintf(msg, sizeof(ui->message), "Output #%d", ctx->confirm_ctr);
+      break;
+
+    case LEDGER_UI_COVENANT_TYPE:
+      strcpy(msg, covenant_labels[out->cov.type]);
+      break;
+
+    case LEDGER_UI_NAME:
+      strcpy(msg, out->cov.name);
+      break;
+
+    case LEDGER_UI_RESOURCE:
+      hns_resource_summary(&out->cov.resource, msg, sizeof(ui->message));
+      break;
+
+    case LEDGER_UI_NEW_OWNER: {
+      hns_transfer_t *t = &out->cov.items.transfer;
+
+      if (!encode_segwit_addr(msg, network, t->addr_ver,
+                                            t->addr_hash,
+                                            t->addr_len)) {
+        THROW(HNS_CANNOT_ENCODE_ADDRESS);
+      }
+
+      break;
+    }
+
+    case LEDGER_UI_VALUE:
+      amount_to_dec(msg, out->val);
+      break;
+
+    case LEDGER_UI_ADDRESS: {
+      hns_addr_t *a = &out->addr;
+
+      if (!encode_segwit_addr(msg, network, a->ver, a->hash, a->hash_len))
+        THROW(HNS_CANNOT_ENCODE_ADDRESS);
+
+      break;
+    }
+
+    default:
+      THROW(HNS_INCORRECT_PARSER_STATE);
+  }
+
+  ui->memo_field = field;
+  ui->memo_output = ctx->confirm_ctr;
+}
+
+UX_STEP_NOCB_INIT(ledger_ui_output_init, pnn,
+  ledger_ui_render(LEDGER_UI_OUTPUT), {
   &C_icon_eye,
   g_ledger.ui.header,
   g_ledger.ui.message
 });
 
-UX_STEP_NOCB(ledger_ui_output_type, bnnn_paging, {
+UX_STEP_NOCB_INIT(ledger_ui_output_type, bnnn_paging,
+  ledger_ui_render(LEDGER_UI_COVENANT_TYPE), {
   .title = "Covenant Type",
-  .text = g_ledger.ui.type
+  .text = g_ledger.ui.message
 });
 
-UX_STEP_NOCB(ledger_ui_output_name, bnnn_paging, {
+UX_STEP_NOCB_INIT(ledger_ui_output_name, bnnn_paging,
+  ledger_ui_render(LEDGER_UI_NAME), {
   .title = "Name",
-  .text = g_ledger.ui.name
+  .text = g_ledger.ui.message
 });
 
-UX_STEP_NOCB(ledger_ui_output_owner, bnnn_paging, {
+UX_STEP_NOCB_INIT(ledger_ui_output_summary, bnnn_paging,
+  ledger_ui_render(LEDGER_UI_RESOURCE), {
+  .title = "Resource",
+  .text = g_ledger.ui.message
+});
+
+UX_STEP_NOCB_INIT(ledger_ui_output_owner, bnnn_paging,
+  ledger_ui_render(LEDGER_UI_NEW_OWNER), {
   .title = "New Owner",
-  .text = g_ledger.ui.owner
+  .text = g_ledger.ui.message
 });
 
-UX_STEP_NOCB(ledger_ui_output_value, bnnn_paging, {
+UX_STEP_NOCB_INIT(ledger_ui_output_value, bnnn_paging,
+  ledger_ui_render(LEDGER_UI_VALUE), {
   .title = "Value",
-  .text = g_ledger.ui.value
+  .text = g_ledger.ui.message
 });
 
-UX_STEP_NOCB(ledger_ui_output_address, bnnn_paging, {
+UX_STEP_NOCB_INIT(ledger_ui_output_address, bnnn_paging,
+  ledger_ui_render(LEDGER_UI_ADDRESS), {
   .title = "Address",
-  .text = g_ledger.ui.address
+  .text = g_ledger.ui.message
 });
 
 UX_STEP_CB(ledger_ui_output_accept, pb, ledger_ui_output_accept_fn(), {
@@ -499,6 +649,17 @@ UX_FLOW(ledger_ui_output_other,
   &ledger_ui_output_reject
 );
 
+UX_FLOW(ledger_ui_output_resource,
+  &ledger_ui_output_init,
+  &ledger_ui_output_type,
+  &ledger_ui_output_name,
+  &ledger_ui_output_summary,
+  &ledger_ui_output_value,
+  &ledger_ui_output_address,
+  &ledger_ui_output_accept,
+  &ledger_ui_output_reject
+);
+
 UX_FLOW(ledger_ui_output_transfer,
   &ledger_ui_output_init,
   &ledger_ui_output_type,
@@ -515,18 +676,13 @@ UX_FLOW(ledger_ui_output_transfer,
  */
 static unsigned int
 ledger_ui_approve_accept_fn(void) {
-  uint8_t len = ledger_apdu_cache_flush(NULL);
-  ledger_apdu_exchange(IO_RETURN_AFTER_TX, len, HNS_OK);
-  g_ledger.ui.must_confirm = false;
-  ledger_ui_idle();
+  ledger_ui_approve_send();
   return 0;
 }
 
 static unsigned int
 ledger_ui_approve_reject_fn(void) {
-  ledger_apdu_buffer_clear();
-  ledger_apdu_exchange(IO_RETURN_AFTER_TX, 0, HNS_CONDITIONS_OF_USE_NOT_SATISFIED);
-  ledger_ui_idle();
+  ledger_ui_reject_send();
   return 0;
 }
 
@@ -551,6 +707,55 @@ UX_FLOW(ledger_ui_approve,
   &ledger_ui_approve_reject
 );
 
+/**
+ * Approval screens for messages that may not fit on one
+ * page, such as the fees or an auction's price schedule.
+ */
+UX_STEP_NOCB(ledger_ui_approve_paging, bnnn_paging, {
+  .title = g_ledger.ui.header,
+  .text = g_ledger.ui.message
+});
+
+UX_FLOW(ledger_ui_approve_long,
+  &ledger_ui_approve_paging,
+  &ledger_ui_approve_accept,
+  &ledger_ui_approve_reject
+);
+
+/**
+ * Message signing screens. The preview and the digest
+ * share the message buffer, so each is rendered when
+ * its step is displayed.
+ */
+static void
+ledger_ui_render_message(enum ledger_ui_state field) {
+  hns_msg_t *msg = (hns_msg_t *)g_ledger.ui.ctx;
+
+  if (field == LEDGER_UI_DIGEST)
+    bin_to_hex(g_ledger.ui.message, msg->digest, sizeof(msg->digest));
+  else
+    strcpy(g_ledger.ui.message, msg->preview);
+}
+
+UX_STEP_NOCB_INIT(ledger_ui_message_preview, bnnn_paging,
+  ledger_ui_render_message(LEDGER_UI_MESSAGE), {
+  .title = "Message",
+  .text = g_ledger.ui.message
+});
+
+UX_STEP_NOCB_INIT(ledger_ui_message_digest, bnnn_paging,
+  ledger_ui_render_message(LEDGER_UI_DIGEST), {
+  .title = "Digest",
+  .text = g_ledger.ui.message
+});
+
+UX_FLOW(ledger_ui_message,
+  &ledger_ui_message_preview,
+  &ledger_ui_message_digest,
+  &ledger_ui_approve_accept,
+  &ledger_ui_approve_reject
+);
+
 void
 ledger_ui_idle(void) {
   if (G_ux.stack_count == 0)
@@ -573,48 +778,20 @@ ledger_ui_init_session(void) {
 
 static void
 handle_output(void) {
-  ledger_ui_ctx_t *ui = &g_ledger.ui;
-  hns_output_t *out = &((hns_tx_t *)ui->ctx)->curr_output;
-  uint8_t netflag = ui->network >> 1;
-  const hns_addr_t *a = &out->addr;
-  char hrp[3];
+  hns_output_t *out = &((hns_tx_t *)g_ledger.ui.ctx)->curr_output;
 
-  if (netflag < 0 || netflag > 3)
+  if (g_ledger.ui.network > 0x06)
     THROW(HNS_INCORRECT_P1);
 
-  strcpy(hrp, network_prefix[netflag]);
-
   if (out->cov.type < HNS_NONE || out->cov.type > HNS_REVOKE)
     THROW(HNS_UNSUPPORTED_COVENANT_TYPE);
 
-  strcpy(ui->type, covenant_labels[out->cov.type]);
-
-  if (out->cov.type != HNS_NONE)
-    strcpy(ui->name, out->cov.name);
-  else
-    ui->name[0] = '\0';
-
-  if (out->cov.type == HNS_TRANSFER) {
-    const hns_transfer_t *t = &out->cov.items.transfer;
-
-    if (!segwit_addr_encode(ui->owner, hrp, t->addr_ver,
-                                            t->addr_hash,
-                                            t->addr_len)) {
-      THROW(HNS_CANNOT_ENCODE_ADDRESS);
-    }
-  } else {
-    ui->owner[0] = '\0';
-  }
-
-  hex_to_dec(ui->value, out->val);
-
-  if (!segwit_addr_encode(ui->address, hrp, a->ver, a->hash, a->hash_len))
-    THROW(HNS_CANNOT_ENCODE_ADDRESS);
-
   if (out->cov.type == HNS_NONE)
     ux_flow_init(0, ledger_ui_output_none, NULL);
   else if (out->cov.type == HNS_TRANSFER)
     ux_flow_init(0, ledger_ui_output_transfer, NULL);
+  else if (out->cov.type == HNS_REGISTER || out->cov.type == HNS_UPDATE)
+    ux_flow_init(0, ledger_ui_output_resource, NULL);
   else
     ux_flow_init(0, ledger_ui_output_other, NULL);
 }
@@ -636,29 +813,104 @@ ledger_ui_update(
     return false;
 
   memmove(g_ledger.ui.header, header, header_len + 1);
-  memmove(g_ledger.ui.message, message, message_len + 1);
+
+  /* Messages are often formatted in place. */
+  if (message != g_ledger.ui.message)
+    memmove(g_ledger.ui.message, message, message_len + 1);
+  g_ledger.ui.state = state;
+  g_ledger.ui.memo_output = 0;
 
   *flags |= IO_ASYNCH_REPLY;
 
   switch (state) {
     case LEDGER_UI_KEY:
-    case LEDGER_UI_FEES:
     case LEDGER_UI_SIGHASH_TYPE: {
       ux_flow_init(0, ledger_ui_approve, NULL);
       break;
     }
 
+    case LEDGER_UI_FEES:
+    case LEDGER_UI_AUCTION: {
+      ux_flow_init(0, ledger_ui_approve_long, NULL);
+      break;
+    }
+
     case LEDGER_UI_OUTPUT: {
       handle_output();
       break;
     }
 
+    case LEDGER_UI_MESSAGE: {
+      ux_flow_init(0, ledger_ui_message, NULL);
+      break;
+    }
+
     default: {
       return false;
     }
   }
 
+  ledger_ui_headless_show();
+
   return true;
 }
 
 #endif /* HAVE_UX_FLOW */
+
+#if defined(HAVE_HEADLESS_UI)
+
+/**
+ * Headless UI, for unattended benchmarks in debug builds. Every
+ * screen is logged, then approved once it has been displayed for
+ * the configured dwell time. On the flow UI each review step is
+ * walked through in turn, so that lazily rendered fields are
+ * rendered and logged as they would be for a user.
+ *
+ * Log lines are prefixed with the number of ticker events since
+ * boot, so that a host can tell the simulated review time apart
+ * from the time spent computing and exchanging apdus.
+ */
+#define HEADLESS_DWELL_TICKS (HNS_HEADLESS_DWELL_MS / HNS_HEADLESS_TICK_MS)
+
+static uint32_t headless_uptime;
+static uint16_t headless_ticks; /* ticks left on screen, 0 if idle */
+
+void
+ledger_ui_headless_show(void) {
+  PRINTF("[%d] %s: %s\n", headless_uptime, g_ledger.ui.header,
+                                           g_ledger.ui.message);
+
+  /* Even without dwell, approve from the next ticker event. */
+  headless_ticks = HEADLESS_DWELL_TICKS + 1;
+}
+
+void
+ledger_ui_headless_tick(void) {
+  headless_uptime++;
+
+  if (headless_ticks == 0 || --headless_ticks > 0)
+    return;
+
+#if !defined(HAVE_UX_FLOW)
+  PRINTF("[%d] approve\n", headless_uptime);
+  ledger_ui_approve_button(BUTTON_EVT_RELEASED | BUTTON_RIGHT, 0);
+#else
+  const ux_flow_step_t *step = ux_flow_get_current();
+
+  if (step == &ledger_ui_output_accept || step == &ledger_ui_approve_accept) {
+    PRINTF("[%d] approve\n", headless_uptime);
+    ux_flow_validate();
+    return;
+  }
+
+  ux_flow_next();
+  step = ux_flow_get_current();
+
+  if (step != &ledger_ui_output_accept && step != &ledger_ui_approve_accept)
+    PRINTF("[%d] %s\n", headless_uptime, g_ledger.ui.message);
+
+  headless_ticks = HEADLESS_DWELL_TICKS + 1;
+#endif
+}
+
+#endif /* HAVE_HEADLESS_UI */
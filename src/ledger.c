@@ -17,19 +17,19 @@ static uint8_t *g_ledger_apdu_buffer;
 static uint16_t g_ledger_apdu_buffer_size;
 
 /**
- * Cache buffer used to save data between APDU calls.
+ * Cache buffers used to save data between APDU calls.
  */
-static uint8_t g_ledger_apdu_cache[LEDGER_APDU_CACHE_SIZE];
+static uint8_t g_ledger_apdu_cache[LEDGER_APDU_CACHE_COUNT][LEDGER_APDU_CACHE_SIZE];
 
 /**
- * Total size of the cache buffer.
+ * Total size of each cache buffer.
  */
 static uint8_t g_ledger_apdu_cache_size;
 
 /**
- * Length of data currently stored in the cache.
+ * Length of data currently stored in each cache.
  */
-static uint8_t g_ledger_apdu_cache_len;
+static uint8_t g_ledger_apdu_cache_len[LEDGER_APDU_CACHE_COUNT];
 
 /**
  * ECDSA BIP32 HD node.
@@ -44,11 +44,11 @@ uint8_t *
 ledger_init(void) {
   g_ledger_apdu_buffer = G_io_apdu_buffer;
   g_ledger_apdu_buffer_size = sizeof(G_io_apdu_buffer);
-  g_ledger_apdu_cache_size = sizeof(g_ledger_apdu_cache);
-  g_ledger_apdu_cache_len = 0;
+  g_ledger_apdu_cache_size = sizeof(g_ledger_apdu_cache[0]);
 
   memset(g_ledger_apdu_buffer, 0, g_ledger_apdu_buffer_size);
-  memset(g_ledger_apdu_cache, 0, g_ledger_apdu_cache_size);
+  memset(g_ledger_apdu_cache, 0, sizeof(g_ledger_apdu_cache));
+  memset(g_ledger_apdu_cache_len, 0, sizeof(g_ledger_apdu_cache_len));
 
   io_seproxyhal_init();
 
@@ -61,6 +61,10 @@ ledger_init(void) {
 
   ledger_ui_init();
 
+#ifdef HAVE_HEADLESS_UI
+  io_seproxyhal_setup_ticker(HNS_HEADLESS_TICK_MS);
+#endif
+
 #ifdef HAVE_BLE
   BLE_power(0, NULL);
   BLE_power(1, "Nano X");
@@ -101,7 +105,14 @@ ledger_apdu_buffer_clear(void) {
 }
 
 bool
-ledger_apdu_cache_write(volatile uint8_t *src, uint8_t src_len) {
+ledger_apdu_cache_write(
+  enum ledger_apdu_cache cache,
+  volatile uint8_t *src,
+  uint8_t src_len
+) {
+  if (cache >= LEDGER_APDU_CACHE_COUNT)
+    return false;
+
   if (src_len < 1)
     return false;
 
@@ -111,18 +122,21 @@ ledger_apdu_cache_write(volatile uint8_t *src, uint8_t src_len) {
   if (src == NULL)
     src = g_ledger_apdu_buffer;
 
-  memmove(g_ledger_apdu_cache, src, src_len);
-  g_ledger_apdu_cache_len = src_len;
+  memmove(g_ledger_apdu_cache[cache], src, src_len);
+  g_ledger_apdu_cache_len[cache] = src_len;
   ledger_apdu_buffer_clear();
 
   return true;
 }
 
 uint8_t
-ledger_apdu_cache_flush(uint16_t *len) {
-  uint8_t *cache = g_ledger_apdu_cache;
+ledger_apdu_cache_flush(enum ledger_apdu_cache cache, uint16_t *len) {
+  if (cache >= LEDGER_APDU_CACHE_COUNT)
+    return 0;
+
+  uint8_t *c = g_ledger_apdu_cache[cache];
   uint8_t *buffer = g_ledger_apdu_buffer;
-  uint8_t cache_len = g_ledger_apdu_cache_len;
+  uint8_t cache_len = g_ledger_apdu_cache_len[cache];
   uint16_t buffer_len = 0;
 
   if (cache_len == 0)
@@ -142,22 +156,28 @@ ledger_apdu_cache_flush(uint16_t *len) {
     memmove(buffer + cache_len, buffer, *len);
   }
 
-  memmove(buffer, cache, cache_len);
+  memmove(buffer, c, cache_len);
   *len += cache_len;
-  ledger_apdu_cache_clear();
+  ledger_apdu_cache_clear(cache);
 
   return cache_len;
 }
 
 uint8_t
-ledger_apdu_cache_check(void) {
-  return g_ledger_apdu_cache_len;
+ledger_apdu_cache_check(enum ledger_apdu_cache cache) {
+  if (cache >= LEDGER_APDU_CACHE_COUNT)
+    return 0;
+
+  return g_ledger_apdu_cache_len[cache];
 }
 
 void
-ledger_apdu_cache_clear(void) {
-  memset(g_ledger_apdu_cache, 0, g_ledger_apdu_cache_size);
-  g_ledger_apdu_cache_len = 0;
+ledger_apdu_cache_clear(enum ledger_apdu_cache cache) {
+  if (cache >= LEDGER_APDU_CACHE_COUNT)
+    return;
+
+  memset(g_ledger_apdu_cache[cache], 0, g_ledger_apdu_cache_size);
+  g_ledger_apdu_cache_len[cache] = 0;
 }
 
 uint16_t
@@ -219,34 +239,52 @@ ledger_ecdsa_derive_node(
 }
 
 void
-ledger_ecdsa_derive_xpub(ledger_ecdsa_xpub_t *xpub) {
+ledger_ecdsa_derive_child(ledger_ecdsa_xpub_t *xpub) {
   /* Derive child node and store pubkey & chain code. */
   ledger_ecdsa_bip32_node_t n;
   ledger_ecdsa_derive_node(xpub->path, xpub->depth, &n);
   memmove(xpub->key, n.pub.W, sizeof(xpub->key));
   memmove(xpub->code, n.chaincode, sizeof(xpub->code));
   memset(&n.prv, 0, sizeof(n.prv));
+}
+
+void
+ledger_ecdsa_derive_fingerprint(uint32_t *path, uint8_t depth, uint8_t *fp) {
+  ledger_ecdsa_bip32_node_t n;
+  uint8_t buf32[32];
+  uint8_t buf20[20];
+  union {
+    cx_sha256_t sha256;
+    cx_ripemd160_t ripemd;
+  } ctx;
+
+  ledger_ecdsa_derive_node(path, depth, &n);
+  cx_sha256_init(&ctx.sha256);
+  cx_hash(&ctx.sha256.header, CX_LAST, n.pub.W, 33, buf32, sizeof(buf32));
+  cx_ripemd160_init(&ctx.ripemd);
+  cx_hash(&ctx.ripemd.header, CX_LAST, buf32, sizeof(buf32), buf20, sizeof(buf20));
+  memmove(fp, buf20, 4);
+  memset(&n.prv, 0, sizeof(n.prv));
+}
+
+void
+ledger_ecdsa_derive_xpub(ledger_ecdsa_xpub_t *xpub) {
+  ledger_ecdsa_derive_child(xpub);
 
   /* Set parent fingerprint to 0x00000000. */
   memset(xpub->fp, 0, sizeof(xpub->fp));
 
   /* If parent exists, store fingerprint. */
-  if (xpub->depth > 1) {
-    uint8_t buf32[32];
-    uint8_t buf20[20];
-    union {
-      cx_sha256_t sha256;
-      cx_ripemd160_t ripemd;
-    } ctx;
-
-    ledger_ecdsa_derive_node(xpub->path, xpub->depth - 1, &n);
-    cx_sha256_init(&ctx.sha256);
-    cx_hash(&ctx.sha256.header, CX_LAST, n.pub.W, 33, buf32, sizeof(buf32));
-    cx_ripemd160_init(&ctx.ripemd);
-    cx_hash(&ctx.ripemd.header, CX_LAST, buf32, sizeof(buf32), buf20, sizeof(buf20));
-    memmove(xpub->fp, buf20, sizeof(xpub->fp));
-    memset(&n.prv, 0, sizeof(n.prv));
-  }
+  if (xpub->depth > 1)
+    ledger_ecdsa_derive_fingerprint(xpub->path, xpub->depth - 1, xpub->fp);
+}
+
+void
+ledger_ecdsa_derive_pubkey(uint32_t *path, uint8_t depth, uint8_t *key) {
+  ledger_ecdsa_bip32_node_t n;
+  ledger_ecdsa_derive_node(path, depth, &n);
+  memmove(key, n.pub.W, 33);
+  memset(&n.prv, 0, sizeof(n.prv));
 }
 
 /**
@@ -399,13 +437,18 @@ ledger_ecdsa_sign(
   uint8_t *hash,
   size_t hash_len,
   volatile uint8_t *sig,
-  uint8_t sig_sz
+  uint8_t sig_sz,
+  volatile uint8_t *key
 ) {
   uint8_t der_sig[72];
   ledger_ecdsa_bip32_node_t n;
   ledger_ecdsa_derive_node(path, depth, &n);
   cx_ecdsa_sign(&n.prv, CX_RND_RFC6979 | CX_LAST, CX_SHA256,
     hash, hash_len, der_sig, sizeof(der_sig), NULL);
+  memset(&n.prv, 0, sizeof(n.prv));
+
+  if (key != NULL)
+    memmove(key, n.pub.W, 33);
 
   return parse_der(der_sig, der_sig[1] + 2, sig, sig_sz);
 }
@@ -446,6 +489,32 @@ ledger_sha3(const void *data, size_t data_sz, void *digest) {
   return true;
 }
 
+bool
+ledger_hmac_sha256(
+  uint32_t *path,
+  uint8_t depth,
+  const void *data,
+  size_t data_sz,
+  void *mac
+) {
+  if (mac == NULL)
+    return false;
+
+  if (data == NULL)
+    return false;
+
+  if (data_sz < 1)
+    return false;
+
+  uint8_t key[32];
+  uint8_t chaincode[32];
+  os_perso_derive_node_bip32(CX_CURVE_256K1, path, depth, key, chaincode);
+  cx_hmac_sha256(key, sizeof(key), data, data_sz, mac, 32);
+  memset(key, 0, sizeof(key));
+
+  return true;
+}
+
 /**
  * BOLOS SDK variable definitions.
  *
@@ -491,6 +560,7 @@ io_event(uint8_t channel) {
       break;
 
     case SEPROXYHAL_TAG_TICKER_EVENT:
+      ledger_ui_headless_tick();
       UX_TICKER_EVENT(G_io_seproxyhal_spi_buffer, {});
       break;
 
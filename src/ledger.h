@@ -19,6 +19,18 @@
  */
 #define LEDGER_APDU_CACHE_SIZE 114
 
+/**
+ * These constants are used to select an apdu cache. Public
+ * key requests own a cache, so they can be handled without
+ * clobbering an in-progress transaction. Message signing
+ * discards the transaction, so it reuses the tx cache.
+ */
+enum ledger_apdu_cache {
+  LEDGER_APDU_CACHE_TX,
+  LEDGER_APDU_CACHE_KEY,
+  LEDGER_APDU_CACHE_COUNT
+};
+
 /**
  * Maximum BIP32 derivation depth.
  */
@@ -42,7 +54,11 @@ enum ledger_ui_state {
   LEDGER_UI_COVENANT_TYPE,
   LEDGER_UI_NAME,
   LEDGER_UI_FEES,
-  LEDGER_UI_SIGHASH_TYPE
+  LEDGER_UI_SIGHASH_TYPE,
+  LEDGER_UI_AUCTION,
+  LEDGER_UI_RESOURCE,
+  LEDGER_UI_MESSAGE,
+  LEDGER_UI_DIGEST
 };
 
 /**
@@ -65,26 +81,21 @@ typedef struct ledger_ecdsa_xpub_s {
  * UI context used to manage on-screen text.
  */
 typedef struct ledger_ui_ctx_s {
-  bool must_confirm;
   char header[14];
   char message[113];
-#if defined(HAVE_UX_FLOW)
-  char type[9];
-  char name[64];
-  char owner[75];
-  char value[22];
-  char address[75];
-#else
+#if !defined(HAVE_UX_FLOW)
   uint8_t message_len;
   uint8_t message_pos;
   char viewport[13];
-  enum ledger_ui_state state;
+#else
+  enum ledger_ui_state memo_field; /* output field in the message */
+  uint8_t memo_output; /* output counter of the memoized field */
 #endif
+  enum ledger_ui_state state;
   void *ctx;
   uint8_t buflen;
   volatile uint8_t *flags;
   uint8_t network;
-  uint8_t ctr;
 } ledger_ui_ctx_t;
 
 /**
@@ -143,6 +154,7 @@ ledger_apdu_buffer_clear(void);
  * src_len amount of bytes from the APDU exchange buffer to the cache.
  *
  * In:
+ * @param cache is the cache to write to.
  * @param src is the data buffer to copy to cache.
  * @param src_len is the amount of data to copy to cache.
  *
@@ -150,7 +162,11 @@ ledger_apdu_buffer_clear(void);
  * @return boolean indicating success or failure.
  */
 bool
-ledger_apdu_cache_write(volatile uint8_t *src, uint8_t src_len);
+ledger_apdu_cache_write(
+  enum ledger_apdu_cache cache,
+  volatile uint8_t *src,
+  uint8_t src_len
+);
 
 /**
  * Copies all data in the cache to the APDU exchange buffer. The len
@@ -162,28 +178,35 @@ ledger_apdu_cache_write(volatile uint8_t *src, uint8_t src_len);
  * cache is empty, the exchange buffer will be left unchanged.
  *
  * In:
+ * @param cache is the cache to flush.
  * @param len is the amount of bytes in the exchange buffer.
  *
  * Out:
  * @return the amount of data added to the exchange buffer from the cache.
  */
 uint8_t
-ledger_apdu_cache_flush(uint16_t *len);
+ledger_apdu_cache_flush(enum ledger_apdu_cache cache, uint16_t *len);
 
 /**
  * Checks the apdu cache buffer for stored data.
  *
+ * In:
+ * @param cache is the cache to check.
+ *
  * Out:
  * @return the amount of bytes stored in the cache.
  */
 uint8_t
-ledger_apdu_cache_check(void);
+ledger_apdu_cache_check(enum ledger_apdu_cache cache);
 
 /**
  * Zeros any bytes in the apdu cache buffer.
+ *
+ * In:
+ * @param cache is the cache to clear.
  */
 void
-ledger_apdu_cache_clear(void);
+ledger_apdu_cache_clear(enum ledger_apdu_cache cache);
 
 /**
  * Exchanges messages over the APDU protocol.
@@ -255,6 +278,29 @@ ledger_blake2b_update(
 void
 ledger_blake2b_final(ledger_blake2b_ctx *ctx, void *digest);
 
+/**
+ * Derives the public key and chain code of an ECDSA extended
+ * public key. The parent fingerprint is left untouched.
+ *
+ * Out:
+ * @param xpub is the extended public key.
+ */
+void
+ledger_ecdsa_derive_child(ledger_ecdsa_xpub_t *xpub);
+
+/**
+ * Derives the BIP32 fingerprint of a node.
+ *
+ * In:
+ * @param path is an array of indices used to derive the node.
+ * @param depth is the number of levels to derive in the HD tree.
+ *
+ * Out:
+ * @param fp is the 4 byte fingerprint.
+ */
+void
+ledger_ecdsa_derive_fingerprint(uint32_t *path, uint8_t depth, uint8_t *fp);
+
 /**
  * Derives an ECDSA extended public key.
  *
@@ -264,6 +310,19 @@ ledger_blake2b_final(ledger_blake2b_ctx *ctx, void *digest);
 void
 ledger_ecdsa_derive_xpub(ledger_ecdsa_xpub_t *xpub);
 
+/**
+ * Derives a compressed ECDSA public key.
+ *
+ * In:
+ * @param path is an array of indices used to derive the key.
+ * @param depth is the number of levels to derive in the HD tree.
+ *
+ * Out:
+ * @param key is the 33 byte compressed public key.
+ */
+void
+ledger_ecdsa_derive_pubkey(uint32_t *path, uint8_t depth, uint8_t *key);
+
 /**
  * Returns an ECDSA signature.
  *
@@ -275,6 +334,7 @@ ledger_ecdsa_derive_xpub(ledger_ecdsa_xpub_t *xpub);
  *
  * Out:
  * @param sig is the resultant signature.
+ * @param key is the 33 byte compressed public key (optional).
  */
 bool
 ledger_ecdsa_sign(
@@ -283,7 +343,8 @@ ledger_ecdsa_sign(
   uint8_t *hash,
   size_t hash_len,
   volatile uint8_t *sig,
-  uint8_t sig_len
+  uint8_t sig_len,
+  volatile uint8_t *key
 );
 
 /**
@@ -314,6 +375,29 @@ ledger_sha256(const void *data, size_t data_sz, void *digest);
 bool
 ledger_sha3(const void *data, size_t data_sz, void *digest);
 
+/**
+ * Returns an HMAC-SHA256 digest keyed with a private key derived
+ * from the device's seed.
+ *
+ * In:
+ * @param path is an array of indices used to derive the mac key.
+ * @param depth is the number of levels to derive in the HD tree.
+ * @param data is the data to authenticate.
+ * @param data_sz is the length of the data.
+ *
+ * Out:
+ * @param mac is the 32 byte mac.
+ * @return boolean indicating success or failure.
+ */
+bool
+ledger_hmac_sha256(
+  uint32_t *path,
+  uint8_t depth,
+  const void *data,
+  size_t data_sz,
+  void *mac
+);
+
 /**
  * Renders the main menu on screen.
  */
@@ -354,4 +438,21 @@ ledger_ui_update(
   char *message,
   volatile uint8_t *flags
 );
+
+#if defined(HAVE_HEADLESS_UI)
+/**
+ * Logs the screen being displayed and schedules its approval.
+ */
+void
+ledger_ui_headless_show(void);
+
+/**
+ * Advances the headless UI by one ticker event.
+ */
+void
+ledger_ui_headless_tick(void);
+#else
+#define ledger_ui_headless_show()
+#define ledger_ui_headless_tick()
+#endif
 #endif
@@ -14,12 +14,20 @@
 #define INS_FIRMWARE 0x40
 #define INS_PUBKEY 0x42
 #define INS_SIGNATURE 0x44
+#define INS_CAPABILITIES 0x46
+#define INS_ACCOUNT_XPUBS 0x48
+#define INS_MESSAGE 0x4a
 
 /**
  * Global ledger constant.
  */
 ledger_ctx_t g_ledger;
 
+/**
+ * Global signing context.
+ */
+hns_sign_ctx_t g_hns_sign;
+
 /**
  * Boots the ledger device.
  */
@@ -71,6 +79,15 @@ hns_loop(void) {
           case INS_SIGNATURE:
             len = hns_apdu_get_input_signature(p1, p2, lc, in, out, &flags);
             break;
+          case INS_CAPABILITIES:
+            len = hns_apdu_get_capabilities(p1, p2, lc, in, out, &flags);
+            break;
+          case INS_ACCOUNT_XPUBS:
+            len = hns_apdu_get_account_xpubs(p1, p2, lc, in, out, &flags);
+            break;
+          case INS_MESSAGE:
+            len = hns_apdu_sign_message(p1, p2, lc, in, out, &flags);
+            break;
           default:
             sw = HNS_INS_NOT_SUPPORTED;
             break;
@@ -0,0 +1,319 @@
+/**
+ * resource.c - streaming decoder for hns resources
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "resource.h"
+
+/**
+ * These constants are used to determine which part
+ * of the resource is currently being decoded.
+ */
+#define VERSION 0x00
+#define RECORD_TYPE 0x01
+#define SKIP 0x02
+#define LABEL_LEN 0x03
+#define LABEL 0x04
+#define POINTER 0x05
+#define DS_DIGEST_LEN 0x06
+#define TXT_COUNT 0x07
+#define TXT_LEN 0x08
+#define TXT 0x09
+
+static const char record_labels[HNS_RECORD_TYPES][7] = {
+  "DS", "NS", "GLUE4", "GLUE6", "SYNTH4", "SYNTH6", "TXT"
+};
+
+/**
+ * Skips the provided number of bytes, then moves on to the next state.
+ */
+static inline void
+skip(hns_resource_t *res, uint8_t len, uint8_t next) {
+  res->left = len;
+  res->next = next;
+  res->state = SKIP;
+}
+
+/**
+ * Keeps a character of the first record's text.
+ */
+static inline void
+capture(hns_resource_t *res, uint8_t ch) {
+  if (res->records != 1)
+    return;
+
+  if (res->first_len == sizeof(res->first) - 1) {
+    res->first_truncated = true;
+    return;
+  }
+
+  if (ch < 0x20 || ch > 0x7e)
+    ch = '?';
+
+  res->first[res->first_len++] = ch;
+  res->first[res->first_len] = '\0';
+}
+
+/**
+ * Moves on to the record data that follows a name.
+ */
+static inline void
+end_name(hns_resource_t *res) {
+  switch(res->type) {
+    case HNS_RECORD_GLUE4:
+      skip(res, 4, RECORD_TYPE);
+      break;
+
+    case HNS_RECORD_GLUE6:
+      skip(res, 16, RECORD_TYPE);
+      break;
+
+    default:
+      res->state = RECORD_TYPE;
+      break;
+  }
+}
+
+/**
+ * Decodes a single byte of the resource.
+ */
+static inline bool
+step(hns_resource_t *res, uint8_t ch) {
+  switch(res->state) {
+    case VERSION: {
+      if (ch != 0)
+        return false;
+
+      res->state = RECORD_TYPE;
+      break;
+    }
+
+    case RECORD_TYPE: {
+      if (ch >= HNS_RECORD_TYPES)
+        return false;
+
+      res->type = ch;
+
+      if (res->records < 0xff)
+        res->records++;
+
+      if (res->counts[ch] < 0xff)
+        res->counts[ch]++;
+
+      if (res->records == 1)
+        res->first_type = ch;
+
+      switch(ch) {
+        case HNS_RECORD_DS:
+          skip(res, 4, DS_DIGEST_LEN); /* key tag, algorithm, digest type */
+          break;
+
+        case HNS_RECORD_NS:
+        case HNS_RECORD_GLUE4:
+        case HNS_RECORD_GLUE6:
+          res->state = LABEL_LEN;
+          break;
+
+        case HNS_RECORD_SYNTH4:
+          skip(res, 4, RECORD_TYPE);
+          break;
+
+        case HNS_RECORD_SYNTH6:
+          skip(res, 16, RECORD_TYPE);
+          break;
+
+        case HNS_RECORD_TXT:
+          res->state = TXT_COUNT;
+          break;
+      }
+
+      break;
+    }
+
+    case SKIP: {
+      if (--res->left == 0)
+        res->state = res->next;
+
+      break;
+    }
+
+    case LABEL_LEN: {
+      if (ch == 0) {
+        end_name(res);
+        break;
+      }
+
+      /* Compression pointers end the name. */
+      if ((ch & 0xc0) == 0xc0) {
+        res->state = POINTER;
+        break;
+      }
+
+      if (ch & 0xc0)
+        return false;
+
+      res->left = ch;
+      res->state = LABEL;
+      break;
+    }
+
+    case LABEL: {
+      capture(res, ch);
+
+      if (--res->left == 0) {
+        capture(res, '.');
+        res->state = LABEL_LEN;
+      }
+
+      break;
+    }
+
+    case POINTER: {
+      capture(res, '*');
+      end_name(res);
+      break;
+    }
+
+    case DS_DIGEST_LEN: {
+      if (ch == 0)
+        res->state = RECORD_TYPE;
+      else
+        skip(res, ch, RECORD_TYPE);
+
+      break;
+    }
+
+    case TXT_COUNT: {
+      res->strings = ch;
+      res->state = ch > 0 ? TXT_LEN : RECORD_TYPE;
+      break;
+    }
+
+    case TXT_LEN: {
+      res->strings--;
+
+      if (ch > 0) {
+        res->left = ch;
+        res->state = TXT;
+        break;
+      }
+
+      res->state = res->strings > 0 ? TXT_LEN : RECORD_TYPE;
+      break;
+    }
+
+    case TXT: {
+      capture(res, ch);
+
+      if (--res->left == 0) {
+        if (res->strings > 0) {
+          capture(res, ' ');
+          res->state = TXT_LEN;
+        } else {
+          res->state = RECORD_TYPE;
+        }
+      }
+
+      break;
+    }
+
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Appends a string to the summary, if there is room.
+ */
+static inline void
+append(char *out, size_t sz, size_t *pos, const char *str) {
+  size_t len = strlen(str);
+
+  if (*pos + len >= sz)
+    len = sz - 1 - *pos;
+
+  memmove(out + *pos, str, len);
+  *pos += len;
+  out[*pos] = '\0';
+}
+
+void
+hns_resource_init(hns_resource_t *res) {
+  memset(res, 0, sizeof(hns_resource_t));
+  res->state = VERSION;
+}
+
+bool
+hns_resource_update(
+  hns_resource_t *res,
+  const volatile uint8_t *data,
+  size_t data_sz
+) {
+  size_t i;
+
+  for (i = 0; i < data_sz; i++)
+    if (!step(res, data[i]))
+      return false;
+
+  return true;
+}
+
+bool
+hns_resource_complete(const hns_resource_t *res) {
+  return res->state == VERSION || res->state == RECORD_TYPE;
+}
+
+void
+hns_resource_summary(const hns_resource_t *res, char *out, size_t sz) {
+  size_t pos = 0;
+  uint8_t i;
+
+  if (sz == 0)
+    return;
+
+  out[0] = '\0';
+
+  if (res->records == 0) {
+    append(out, sz, &pos, "Empty");
+    return;
+  }
+
+  for (i = 0; i < HNS_RECORD_TYPES; i++) {
+    char count[5];
+    uint8_t n = res->counts[i];
+    uint8_t j = sizeof(count) - 1;
+
+    if (n == 0)
+      continue;
+
+    count[j] = '\0';
+
+    do {
+      count[--j] = '0' + n % 10;
+      n /= 10;
+    } while (n > 0);
+
+    count[--j] = ' ';
+
+    if (pos > 0)
+      append(out, sz, &pos, ", ");
+
+    append(out, sz, &pos, record_labels[i]);
+    append(out, sz, &pos, count + j);
+  }
+
+  if (res->first_len == 0)
+    return;
+
+  append(out, sz, &pos, "; ");
+  append(out, sz, &pos, record_labels[res->first_type]);
+  append(out, sz, &pos, " ");
+  append(out, sz, &pos, res->first);
+
+  if (res->first_truncated)
+    append(out, sz, &pos, "...");
+}
@@ -0,0 +1,106 @@
+/**
+ * resource.h - header file for the hns resource decoder.
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#ifndef _HNS_RESOURCE_H
+#define _HNS_RESOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum size of a serialized resource.
+ */
+#define HNS_RESOURCE_MAX_SIZE 512
+
+/**
+ * These constants are used to determine the resource record type.
+ */
+#define HNS_RECORD_DS 0x00
+#define HNS_RECORD_NS 0x01
+#define HNS_RECORD_GLUE4 0x02
+#define HNS_RECORD_GLUE6 0x03
+#define HNS_RECORD_SYNTH4 0x04
+#define HNS_RECORD_SYNTH6 0x05
+#define HNS_RECORD_TXT 0x06
+#define HNS_RECORD_TYPES 0x07
+
+/**
+ * Size of the text kept from the first record, including
+ * the null terminator.
+ */
+#define HNS_RESOURCE_FIRST_SIZE 24
+
+/**
+ * Streaming resource decoder. The decoder validates the resource
+ * serialization one byte at a time and keeps a summary of the
+ * records. The resource itself is never buffered.
+ */
+typedef struct hns_resource_s {
+  uint8_t state;
+  uint8_t next; /* state after skipped bytes */
+  uint8_t type; /* type of the current record */
+  uint8_t left; /* bytes left in the current field */
+  uint8_t strings; /* TXT strings left in the current record */
+  uint8_t records;
+  uint8_t counts[HNS_RECORD_TYPES];
+  uint8_t first_type;
+  uint8_t first_len;
+  bool first_truncated;
+  char first[HNS_RESOURCE_FIRST_SIZE];
+} hns_resource_t;
+
+/**
+ * Initializes the resource decoder.
+ *
+ * Out:
+ * @param res is the resource decoder.
+ */
+void
+hns_resource_init(hns_resource_t *res);
+
+/**
+ * Decodes the next chunk of a serialized resource.
+ *
+ * In:
+ * @param data is the resource data.
+ * @param data_sz is the length of the resource data.
+ *
+ * Out:
+ * @param res is the resource decoder.
+ * @return a boolean indicating if the data is well formed.
+ */
+bool
+hns_resource_update(
+  hns_resource_t *res,
+  const volatile uint8_t *data,
+  size_t data_sz
+);
+
+/**
+ * Checks that the decoded data is a complete resource.
+ *
+ * In:
+ * @param res is the resource decoder.
+ * @return a boolean indicating if the resource is complete.
+ */
+bool
+hns_resource_complete(const hns_resource_t *res);
+
+/**
+ * Writes a summary of the resource's records, e.g.
+ * "NS 2, TXT 1; NS ns1.example.", as a null terminated string.
+ *
+ * In:
+ * @param res is the resource decoder.
+ * @param sz is the size of the output buffer.
+ *
+ * Out:
+ * @param out is the summary.
+ */
+void
+hns_resource_summary(const hns_resource_t *res, char *out, size_t sz);
+
+#endif
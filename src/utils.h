@@ -10,7 +10,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
+#include "amount.h"
 #include "ledger.h"
+#include "segwit-addr.h"
 
 /**
  * General constants.
@@ -69,149 +71,39 @@ bin_to_hex(char *hex, uint8_t *bin, uint8_t len) {
 }
 
 /**
- * See: https://github.com/LedgerHQ/ledger-app-btc/blob/08c7f5dfc324d39afe3df8b7fb80f5c7c0990f79/src/btchip_bcd.c#L23
+ * Encodes a witness program as a bech32 address. The set of
+ * hrps is fixed, so their checksum states are precomputed
+ * (see bech32_hrp_chk) rather than derived for every address.
  *
- * Note: ledger-app-btc stores output values in big-endian format, while
- * ledger-app-hns uses little-endian. This function converts the amount
- * to big-endian before processing.
- */
-
-#define LOOP_1_SIZE 15
-#define LOOP_2_SIZE 6
-#define TMP_SIZE (LOOP_1_SIZE + LOOP_2_SIZE)
-
-static inline uint8_t
-hex_to_dec(char *dec, uint8_t *hex) {
-  uint8_t i,j;
-  uint8_t amt[8];
-  uint8_t tmp[TMP_SIZE];
-  uint8_t ntmp = TMP_SIZE;
-  uint8_t smin = ntmp - 2;
-
-  for (i = 0; i < 8; i++)
-    amt[i] = hex[8 - 1 - i];
-
-  for (i = 0; i < TMP_SIZE; i++)
-    tmp[i] = 0;
-
-  for (i = 0; i < 8; i++) {
-    for (j = 0; j < 8; j++) {
-      uint8_t k;
-      uint16_t shift = (((amt[i] & 0xff) & ((1 << (7 - j)))) != 0) ? 1 : 0;
-
-      for (k = smin; k < ntmp; k++)
-        tmp[k] += ((tmp[k] >= 5) ? 3 : 0);
-
-      if (tmp[smin] >= 8)
-        smin -= 1;
-
-      for (k = smin; k < ntmp - 1; k++)
-        tmp[k] = ((tmp[k] << 1) & 0x0f) | ((tmp[k + 1] >= 8) ? 1 : 0);
-
-      tmp[ntmp - 1] = ((tmp[ntmp - 1] << 1) & 0x0f) | (shift == 1 ? 1 : 0);
-    }
-  }
-
-  uint8_t non_zero = 0;
-  uint8_t offset = 0;
-  uint8_t target_offset = 0;
-
-  for (i = 0; i < LOOP_1_SIZE; i++) {
-    if (!non_zero && (tmp[offset] == 0)) {
-      offset++;
-    } else {
-      non_zero = 1;
-      dec[target_offset++] = tmp[offset++] + '0';
-    }
-  }
-
-  if (target_offset == 0)
-    dec[target_offset++] = '0';
-
-  uint8_t work_offset = offset;
-  uint8_t period = 0;
-
-  for (i = 0; i < LOOP_2_SIZE; i++) {
-    uint8_t all_zero = 1;
-
-    for (j = i; j < LOOP_2_SIZE; j++) {
-      if (tmp[work_offset + j] != 0) {
-        all_zero = 0;
-        break;
-      }
-    }
-
-    if (all_zero)
-      break;
-
-    if (!period) {
-      dec[target_offset++] = '.';
-      period = 1;
-    }
-
-    dec[target_offset++] = tmp[offset++] + '0';
-  }
-
-  dec[target_offset] = '\0';
-
-  return target_offset;
-}
-
-/**
- * See: https://github.com/LedgerHQ/ledger-app-btc/blob/08c7f5dfc324d39afe3df8b7fb80f5c7c0990f79/src/btchip_transaction.c#L38
- *
- * Note: the above function accepts big-endian integers.
- * add_u64 accepts little-endian integers.
- */
-
-static inline uint8_t
-add_u64(uint8_t *target, uint8_t *a, uint8_t *b) {
-  uint8_t carry = 0;
-  uint8_t i;
-
-  for (i = 0; i < 8; i++) {
-    unsigned short val = a[i] + b[i] + (carry ? 1 : 0);
-    carry = (val > 255);
-    target[i] = (val & 255);
-  }
-
-  return carry;
-}
-
-/**
- * See: https://github.com/LedgerHQ/ledger-app-btc/blob/08c7f5dfc324d39afe3df8b7fb80f5c7c0990f79/src/btchip_transaction.c#L51
+ * In:
+ * @param network is the network index, i.e. mainnet, testnet,
+ *        regtest or simnet.
+ * @param ver is the witness program version.
+ * @param hash is the witness program.
+ * @param hash_len is the length of the witness program.
  *
- * Note: the above function accepts big-endian integers.
- * sub_u64 accepts little-endian integers.
+ * Out:
+ * @param addr is the encoded address.
+ * @return a boolean indicating success or failure.
  */
+static inline bool
+encode_segwit_addr(
+  char *addr,
+  uint8_t network,
+  uint8_t ver,
+  const uint8_t *hash,
+  size_t hash_len
+) {
+  static const char hrp[4][3] = {"hs", "ts", "rs", "ss"};
+  static const uint32_t hrp_chk[4] = {
+    0x02318113, 0x02318293, 0x02318253, 0x02318273
+  };
 
-static inline uint8_t
-sub_u64(uint8_t *target, uint8_t *a, uint8_t *b) {
-  uint8_t borrow = 0;
-  uint8_t i;
-
-  for (i = 0; i < 8; i++) {
-    unsigned short ta = a[i];
-    unsigned short tb = b[i];
-
-    if (borrow) {
-      if (ta <= tb) {
-        ta += (255 + 1) - 1;
-      } else {
-        borrow = 0;
-        ta--;
-      }
-    }
-
-    if (ta < tb) {
-      borrow = 1;
-      ta += 255 + 1;
-    }
-
-    target[i] = (uint8_t)(ta - tb);
-  }
+  if (network > 3)
+    return false;
 
-  return borrow;
+  return segwit_addr_encode_seeded(addr, hrp[network], hrp_chk[network],
+                                   ver, hash, hash_len);
 }
 
 
@@ -290,6 +182,28 @@ read_u32(volatile uint8_t **buf, uint16_t *len, uint32_t *u32, bool be) {
   return true;
 }
 
+static inline bool
+read_u64(volatile uint8_t **buf, uint16_t *len, uint64_t *u64, bool be) {
+  if (*len < 8)
+    return false;
+
+  if (be) {
+    uint8_t i;
+
+    *u64 = 0;
+
+    for (i = 0; i < 8; i++)
+      *u64 = (*u64 << 8) | (uint64_t)(*buf)[i];
+  } else {
+    memmove(u64, *buf, 8);
+  }
+
+  *buf += 8;
+  *len -= 8;
+
+  return true;
+}
+
 static inline bool
 read_varint(volatile uint8_t **buf, uint16_t *len, hns_varint_t *varint) {
   if (*len < 1)
@@ -538,6 +452,25 @@ write_u32(volatile uint8_t **buf, uint32_t u32, bool be) {
   return 4;
 }
 
+static inline size_t
+write_u64(volatile uint8_t **buf, uint64_t u64, bool be) {
+  if (buf == NULL || *buf == NULL)
+    return 0;
+
+  if (be) {
+    uint8_t i;
+
+    for (i = 0; i < 8; i++)
+      (*buf)[i] = (uint8_t)(u64 >> (56 - 8 * i));
+  } else {
+    memmove(*buf, &u64, 8);
+  }
+
+  *buf += 8;
+
+  return 8;
+}
+
 static inline size_t
 write_bytes(
   volatile uint8_t **buf,
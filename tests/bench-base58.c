@@ -0,0 +1,71 @@
+/**
+ * bench-base58.c - host benchmark of the base58 xpub encoders
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ *
+ * Host timings only show the relative cost of the two encoders.
+ * The device has no 64-bit divider, so the absolute numbers, and
+ * likely the ratio, differ on the Cortex-M0.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "libbase58.h"
+#include "xpubs.h"
+
+#define CORPUS_SIZE 1024
+#define ROUNDS 100
+
+typedef bool (*encoder_t)(char *, size_t *, const void *, size_t);
+
+static uint8_t corpus[4][CORPUS_SIZE][82];
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the mean time in ns to encode an xpub of the given prefix.
+ */
+static double
+bench(encoder_t enc, int prefix, size_t *sink) {
+  char b58[128];
+  double start = now();
+  int r, i;
+
+  for (r = 0; r < ROUNDS; r++) {
+    for (i = 0; i < CORPUS_SIZE; i++) {
+      size_t sz = sizeof(b58);
+      enc(b58, &sz, corpus[prefix][i], 82);
+      *sink += sz + b58[sz / 2];
+    }
+  }
+
+  return (now() - start) * 1e9 / (ROUNDS * CORPUS_SIZE);
+}
+
+int
+main(void) {
+  static const char *names[4] = {"mainnet", "testnet", "regtest", "simnet"};
+  uint64_t x = 0x2545f4914f6cdd1dULL;
+  size_t sink = 0;
+  int p, i;
+
+  for (p = 0; p < 4; p++)
+    for (i = 0; i < CORPUS_SIZE; i++)
+      make_xpub(corpus[p][i], xpub_prefixes[p], &x);
+
+  printf("%-8s %12s %12s %8s\n", "network", "b58enc ns", "limbs ns", "speedup");
+
+  for (p = 0; p < 4; p++) {
+    double ref = bench(b58enc, p, &sink);
+    double limbs = bench(b58enc_limbs, p, &sink);
+    printf("%-8s %12.0f %12.0f %7.2fx\n", names[p], ref, limbs, ref / limbs);
+  }
+
+  return sink == 0;
+}
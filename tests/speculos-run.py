@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+#
+# Replay APDU transcripts against a set of Speculos instances.
+#
+# Each transcript is a text file of exchanges:
+#
+#   # comment
+#   => e040000000
+#   <= 9000
+#
+# A "=>" line is sent as one APDU. An optional "<=" line after it is the
+# expected reply: four hex digits compare the status word only, anything
+# longer compares the whole reply. Transcripts are split across one worker
+# per APDU port. A worker that runs out of work steals from the back of the
+# busiest queue, so one slow device does not hold up the run. Latency is
+# aggregated per transcript and printed once all workers have finished.
+#
+# Usage: speculos-run.py [-p PORT]... [-r REPEAT] TRANSCRIPT...
+
+import argparse
+import collections
+import os
+import socket
+import statistics
+import struct
+import sys
+import threading
+import time
+
+
+def load(path):
+  steps = []
+
+  with open(path) as f:
+    for n, line in enumerate(f, 1):
+      line = line.split('#', 1)[0].strip()
+
+      if not line:
+        continue
+
+      if line.startswith('=>'):
+        steps.append([bytes.fromhex(line[2:]), None])
+      elif line.startswith('<=') and steps and steps[-1][1] is None:
+        steps[-1][1] = line[2:].replace(' ', '').lower()
+      else:
+        raise ValueError('%s:%d: bad line' % (path, n))
+
+  return steps
+
+
+def recv_exact(sock, size):
+  data = b''
+
+  while len(data) < size:
+    chunk = sock.recv(size - len(data))
+
+    if not chunk:
+      raise ConnectionError('emulator closed the connection')
+
+    data += chunk
+
+  return data
+
+
+def exchange(sock, apdu):
+  sock.sendall(struct.pack('>I', len(apdu)) + apdu)
+  size, = struct.unpack('>I', recv_exact(sock, 4))
+  return recv_exact(sock, size + 2)
+
+
+def replay(sock, name, steps):
+  start = time.monotonic()
+
+  for i, (apdu, expect) in enumerate(steps):
+    reply = exchange(sock, apdu).hex()
+    got = reply[-4:] if expect is not None and len(expect) == 4 else reply
+
+    if expect is not None and got != expect:
+      raise AssertionError('%s: step %d: expected %s, got %s'
+                           % (name, i + 1, expect, reply))
+
+  return time.monotonic() - start
+
+
+class Runner:
+  def __init__(self, ports, jobs):
+    self.lock = threading.Lock()
+    self.queues = [collections.deque() for _ in ports]
+    self.ports = ports
+    self.times = collections.defaultdict(list)
+    self.failures = []
+
+    for i, job in enumerate(jobs):
+      self.queues[i % len(ports)].append(job)
+
+  def next(self, i):
+    with self.lock:
+      if self.queues[i]:
+        return self.queues[i].popleft()
+
+      victim = max(self.queues, key=len)
+
+      if victim:
+        return victim.pop()
+
+      return None
+
+  def work(self, i):
+    with socket.create_connection(('127.0.0.1', self.ports[i])) as sock:
+      while True:
+        job = self.next(i)
+
+        if job is None:
+          return
+
+        name, steps = job
+
+        try:
+          elapsed = replay(sock, name, steps)
+        except AssertionError as e:
+          with self.lock:
+            self.failures.append(str(e))
+          continue
+
+        with self.lock:
+          self.times[name].append(elapsed)
+
+  def run(self):
+    threads = [threading.Thread(target=self.work, args=(i,))
+               for i in range(len(self.ports))]
+
+    for t in threads:
+      t.start()
+
+    for t in threads:
+      t.join()
+
+
+def pct(values, p):
+  values = sorted(values)
+  return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Replay APDU transcripts.')
+  parser.add_argument('-p', '--port', type=int, action='append',
+                      help='Speculos APDU port (repeat for each instance)')
+  parser.add_argument('-r', '--repeat', type=int, default=1,
+                      help='times to run each transcript')
+  parser.add_argument('transcripts', nargs='+')
+  args = parser.parse_args()
+
+  ports = args.port or [9999]
+  jobs = []
+
+  for path in args.transcripts:
+    name = os.path.basename(path)
+    steps = load(path)
+    jobs.extend((name, steps) for _ in range(args.repeat))
+
+  runner = Runner(ports, jobs)
+  runner.run()
+
+  print('%-32s %6s %9s %9s %9s' % ('transcript', 'runs', 'p50 ms',
+                                   'p90 ms', 'max ms'))
+
+  for name in sorted(runner.times):
+    t = runner.times[name]
+    print('%-32s %6d %9.1f %9.1f %9.1f'
+          % (name, len(t), statistics.median(t) * 1000,
+             pct(t, 90) * 1000, max(t) * 1000))
+
+  for failure in runner.failures:
+    print('FAIL ' + failure, file=sys.stderr)
+
+  return 1 if runner.failures else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,143 @@
+/**
+ * test-amount.c - host tests for the hns amount helpers
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "amount.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {     \
+  if (!(cond)) {                  \
+    printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+    printf(__VA_ARGS__);          \
+    printf("\n");                 \
+    failures++;                   \
+  }                               \
+} while (0)
+
+/**
+ * Reference formatter, using 64-bit division.
+ */
+static void
+format_ref(char *dec, hns_amount_t amt) {
+  int len = sprintf(dec, "%" PRIu64 ".%06" PRIu64,
+                    amt / 1000000, amt % 1000000);
+
+  while (dec[len - 1] == '0')
+    dec[--len] = '\0';
+
+  if (dec[len - 1] == '.')
+    dec[--len] = '\0';
+}
+
+static void
+check_format(hns_amount_t amt, const char *expect) {
+  char dec[22];
+  char ref[32];
+  uint8_t len;
+
+  memset(dec, 0x7f, sizeof(dec));
+  len = amount_to_dec(dec, amt);
+  format_ref(ref, amt);
+
+  CHECK(strcmp(dec, ref) == 0, "%" PRIu64 ": got %s, want %s", amt, dec, ref);
+  CHECK(len == strlen(dec), "%" PRIu64 ": length %u", amt, len);
+
+  if (expect != NULL)
+    CHECK(strcmp(dec, expect) == 0, "%" PRIu64 ": got %s, want %s",
+          amt, dec, expect);
+}
+
+static void
+test_format_edges(void) {
+  int i;
+
+  check_format(0, "0");
+  check_format(1, "0.000001");
+  check_format(10, "0.00001");
+  check_format(999999, "0.999999");
+  check_format(1000000, "1");
+  check_format(1000001, "1.000001");
+  check_format(1500000, "1.5");
+  check_format(UINT64_MAX, "18446744073709.551615");
+  check_format(UINT64_MAX - 1, "18446744073709.551614");
+
+  /* Carries across the 10^4 digit groups. */
+  check_format(9999, "0.009999");
+  check_format(10000, "0.01");
+  check_format(10001, "0.010001");
+  check_format(99999999, "99.999999");
+  check_format(100000000, "100");
+  check_format(999999999999ULL, "999999.999999");
+  check_format(1000000000000ULL, "1000000");
+  check_format(9999999999999999ULL, "9999999999.999999");
+  check_format(10000000000000000ULL, "10000000000");
+
+  /* Carries across the 16-bit chunks. */
+  for (i = 1; i < 64; i++) {
+    check_format((hns_amount_t)1 << i, NULL);
+    check_format(((hns_amount_t)1 << i) - 1, NULL);
+    check_format(((hns_amount_t)1 << i) + 1, NULL);
+  }
+}
+
+static void
+test_format_random(void) {
+  uint64_t x = 0x9e3779b97f4a7c15ULL;
+  int i;
+
+  for (i = 0; i < 1000000; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+
+    /* Cover every magnitude, not just huge values. */
+    check_format(x >> (x & 63), NULL);
+  }
+}
+
+static void
+test_add_sub(void) {
+  hns_amount_t r;
+
+  CHECK(add_amount(&r, 0, 0) && r == 0, "0 + 0");
+  CHECK(add_amount(&r, 1, 2) && r == 3, "1 + 2");
+  CHECK(add_amount(&r, UINT64_MAX, 0) && r == UINT64_MAX, "max + 0");
+  CHECK(add_amount(&r, UINT64_MAX - 1, 1) && r == UINT64_MAX, "max - 1 + 1");
+
+  r = 42;
+  CHECK(!add_amount(&r, UINT64_MAX, 1), "max + 1 overflows");
+  CHECK(!add_amount(&r, 1, UINT64_MAX), "1 + max overflows");
+  CHECK(!add_amount(&r, UINT64_MAX, UINT64_MAX), "max + max overflows");
+  CHECK(r == 42, "target is untouched on overflow");
+
+  CHECK(sub_amount(&r, 0, 0) && r == 0, "0 - 0");
+  CHECK(sub_amount(&r, 3, 1) && r == 2, "3 - 1");
+  CHECK(sub_amount(&r, 1, 1) && r == 0, "1 - 1");
+  CHECK(sub_amount(&r, UINT64_MAX, UINT64_MAX) && r == 0, "max - max");
+  CHECK(sub_amount(&r, UINT64_MAX, 0) && r == UINT64_MAX, "max - 0");
+
+  r = 42;
+  CHECK(!sub_amount(&r, 0, 1), "0 - 1 underflows");
+  CHECK(!sub_amount(&r, UINT64_MAX - 1, UINT64_MAX), "max - 1 - max underflows");
+  CHECK(r == 42, "target is untouched on underflow");
+}
+
+int
+main(void) {
+  test_format_edges();
+  test_format_random();
+  test_add_sub();
+
+  if (failures != 0) {
+    printf("test-amount: %d failures\n", failures);
+    return 1;
+  }
+
+  printf("test-amount: ok\n");
+  return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * test-base58.c - host tests for the limb base58 encoder
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "libbase58.h"
+#include "xpubs.h"
+
+static int failures = 0;
+
+/**
+ * Asserts that b58enc_limbs matches b58enc, including the
+ * required size reported when the output buffer is too small.
+ */
+static void
+check_encode(const uint8_t *data, size_t len, size_t b58_cap) {
+  char ref[256];
+  char out[256];
+  size_t ref_sz = b58_cap;
+  size_t out_sz = b58_cap;
+  bool ref_ok, out_ok;
+
+  memset(ref, 0x7f, sizeof(ref));
+  memset(out, 0x7f, sizeof(out));
+
+  ref_ok = b58enc(ref, &ref_sz, data, len);
+  out_ok = b58enc_limbs(out, &out_sz, data, len);
+
+  if (ref_ok != out_ok || ref_sz != out_sz ||
+      (ref_ok && strcmp(ref, out) != 0)) {
+    size_t i;
+
+    printf("FAIL len=%zu cap=%zu: got %d/%zu %s, want %d/%zu %s\n  data=",
+           len, b58_cap, out_ok, out_sz, out_ok ? out : "",
+           ref_ok, ref_sz, ref_ok ? ref : "");
+
+    for (i = 0; i < len; i++)
+      printf("%02x", data[i]);
+
+    printf("\n");
+    failures++;
+  }
+}
+
+static void
+test_edges(void) {
+  uint8_t data[100];
+  size_t len, i;
+
+  for (len = 0; len <= sizeof(data); len++) {
+    memset(data, 0x00, len);
+    check_encode(data, len, 256);
+
+    memset(data, 0xff, len);
+    check_encode(data, len, 256);
+
+    /* Leading zeros followed by a single byte. */
+    for (i = 0; i < len; i++) {
+      memset(data, 0x00, len);
+      data[i] = 0x01;
+      check_encode(data, len, 256);
+    }
+  }
+}
+
+static void
+test_small_buffers(void) {
+  uint64_t x = 1;
+  uint8_t data[82];
+  size_t cap;
+
+  make_xpub(data, xpub_prefixes[0], &x);
+
+  for (cap = 0; cap <= 120; cap++)
+    check_encode(data, sizeof(data), cap);
+}
+
+static void
+test_random(void) {
+  uint64_t x = 0x9e3779b97f4a7c15ULL;
+  uint8_t data[100];
+  int i;
+
+  for (i = 0; i < 200000; i++) {
+    size_t len = xorshift(&x) % (sizeof(data) + 1);
+    size_t zeros = len ? xorshift(&x) % (len + 1) % 4 : 0;
+    size_t j;
+
+    for (j = 0; j < len; j++)
+      data[j] = j < zeros ? 0 : xorshift(&x);
+
+    check_encode(data, len, 256);
+  }
+}
+
+static void
+test_xpubs(void) {
+  uint64_t x = 0x2545f4914f6cdd1dULL;
+  uint8_t data[82];
+  int p, i;
+
+  for (p = 0; p < 4; p++) {
+    for (i = 0; i < 50000; i++) {
+      make_xpub(data, xpub_prefixes[p], &x);
+      check_encode(data, sizeof(data), 256);
+    }
+  }
+}
+
+int
+main(void) {
+  test_edges();
+  test_small_buffers();
+  test_random();
+  test_xpubs();
+
+  if (failures != 0) {
+    printf("test-base58: %d failures\n", failures);
+    return 1;
+  }
+
+  printf("test-base58: ok\n");
+  return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * xpubs.h - xpub-shaped inputs for the base58 tests and benchmark
+ * Copyright (c) 2018, Boyma Fahnbulleh (MIT License).
+ * https://github.com/handshake-org/ledger-app-hns
+ */
+#ifndef _HNS_TEST_XPUBS_H
+#define _HNS_TEST_XPUBS_H
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Xpub version prefixes, as in apdu-pubkey.c.
+ */
+static const uint32_t xpub_prefixes[4] = {
+  0x0488b21e, /* mainnet */
+  0x043587cf, /* testnet */
+  0xeab4fa05, /* regtest */
+  0x0420bd3a  /* simnet */
+};
+
+/**
+ * Deterministic pseudo-random generator (xorshift64).
+ */
+static inline uint64_t
+xorshift(uint64_t *x) {
+  *x ^= *x << 13;
+  *x ^= *x >> 7;
+  *x ^= *x << 17;
+  return *x;
+}
+
+/**
+ * Fills an 82-byte serialized xpub: prefix, depth, fingerprint,
+ * child number, chain code, compressed key and checksum. The
+ * checksum is random, which does not matter to the encoder.
+ */
+static inline void
+make_xpub(uint8_t *data, uint32_t prefix, uint64_t *x) {
+  size_t i;
+
+  data[0] = prefix >> 24;
+  data[1] = prefix >> 16;
+  data[2] = prefix >> 8;
+  data[3] = prefix;
+
+  for (i = 4; i < 82; i++)
+    data[i] = xorshift(x);
+
+  data[4] = 1 + data[4] % 5; /* depth */
+  data[45] = 2 + (data[45] & 1); /* key parity */
+}
+
+#endif